@@ -1,2 +1,5 @@
+#ifndef BIND_UTILS_H
+#define BIND_UTILS_H
 #define SSB(name, struct) layout(binding = 1) buffer S_##name struct _##name[];
-#define GET(name) (_##name[name##Bind])
\ No newline at end of file
+#define GET(name) (_##name[name##Bind])
+#endif
\ No newline at end of file
@@ -0,0 +1,113 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Rebuilds the full resolution image from a checkerboard frame. The scene is
+// rendered at half resolution with 2x MSAA and per sample shading, the two
+// standard sample positions land on one diagonal of every 2x2 pixel block and
+// the projection jitter alternates the diagonal each frame. Pixels that were
+// not shaded this frame are reprojected from the history using the analytic
+// wave height at the previous frame's time.
+
+layout (location = 0) in vec2 uv;
+
+layout (location = 0) out vec4 color;
+layout (location = 1) out float outDepth;
+
+layout(binding = 0) uniform sampler2D textures[];
+layout(binding = 0) uniform sampler2DMS texturesMS[];
+
+#define WATER_CUSTOM_CONSTANTS
+layout (push_constant) uniform constants {
+    mat4 prevProjView;
+    uint colorSource;
+    uint depthSource;
+    uint history;
+    uint materialBind;
+    // Full resolution size covered by the half resolution targets
+    uvec2 fullSize;
+    // Fraction of the history texture covered by the previous frame
+    vec2 historyUvScale;
+    uint globalsBind;
+    float prevTime;
+    uint parity;
+    uint historyValid;
+};
+
+#include "water.h"
+
+// Later waves move the surface by less than a pixel, skip them when
+// reprojecting
+const uint REPROJECTION_WAVES = 24;
+
+bool isShaded(ivec2 p) {
+    return ((p.x + p.y + int(parity)) & 1) == 0;
+}
+
+// Inverse of the sample placement, only valid for shaded pixels
+void fetchShaded(ivec2 p, out vec3 c, out float d) {
+    p = clamp(p, ivec2(0), ivec2(fullSize) - 1);
+    int sampleIndex = (p.y & 1) == 1 ? 0 : 1;
+    ivec2 halfPixel = ivec2((p.x - int(parity) - (p.y & 1)) >> 1, p.y >> 1);
+    halfPixel = max(halfPixel, ivec2(0));
+    c = texelFetch(texturesMS[colorSource], halfPixel, sampleIndex).rgb;
+    d = texelFetch(texturesMS[depthSource], halfPixel, sampleIndex).r;
+}
+
+void main() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    vec2 screenUv = (vec2(p) + 0.5) / vec2(fullSize);
+
+    if (isShaded(p)) {
+        vec3 c;
+        fetchShaded(p, c, outDepth);
+        color = vec4(c, 1);
+        return;
+    }
+
+    // The 4 direct neighbours are always shaded
+    const ivec2 offsets[4] = {ivec2(-1, 0), ivec2(1, 0), ivec2(0, -1), ivec2(0, 1)};
+    vec3 neighbours[4];
+    float depths[4];
+    vec3 mn = vec3(1e10), mx = vec3(-1e10), average = vec3(0);
+    float waterDepth = 0;
+    int waterCount = 0;
+    for (int i = 0; i < 4; i++) {
+        fetchShaded(p + offsets[i], neighbours[i], depths[i]);
+        mn = min(mn, neighbours[i]);
+        mx = max(mx, neighbours[i]);
+        average += neighbours[i] * 0.25;
+        if (depths[i] < 1) {
+            waterDepth += depths[i];
+            waterCount++;
+        }
+    }
+
+    // The sky is smooth enough to be interpolated
+    if (waterCount < 2) {
+        color = vec4(average, 1);
+        outDepth = 1;
+        return;
+    }
+
+    outDepth = waterDepth / waterCount;
+
+    vec4 world = GET(globals).invProjView * vec4(screenUv * 2 - 1, outDepth, 1);
+    world /= world.w;
+
+    // The surface only moves vertically
+    vec3 prevWorld = vec3(world.x, WaveHeight(world.xz, prevTime, REPROJECTION_WAVES), world.z);
+    vec4 prevClip = prevProjView * vec4(prevWorld, 1);
+    vec2 prevUv = prevClip.xy / prevClip.w * 0.5 + 0.5;
+
+    bool onScreen = prevClip.w > 0 && all(greaterThanEqual(prevUv, vec2(0))) &&
+                    all(lessThanEqual(prevUv, vec2(1)));
+    if (historyValid == 0 || !onScreen) {
+        color = vec4(average, 1);
+        return;
+    }
+
+    vec3 previous = texture(textures[history], prevUv * historyUvScale).rgb;
+
+    // Keep disoccluded or stale history from ghosting
+    color = vec4(clamp(previous, mn, mx), 1);
+}
@@ -0,0 +1,29 @@
+// Height fog and tonemapping shared by the post process passes, needs
+// globalData.h
+
+const float fogDensity = 0.005;
+const float fogGradient = 2.5;
+
+const float minHeightFog = 0.5;
+const float maxHeightFog = 100;
+
+const vec4 fogColor = vec4(1) * lightStrength;
+
+// Water shading tiers, picked by how much of the surface survives the fog.
+// Above the first the full GGX path is used, below the second the wave
+// normal is skipped.
+const float fullShadingVisibility = 0.5;
+const float farShadingVisibility = 0.05;
+
+// Fraction of the surface colour that reaches the camera, viewDepth is the
+// distance along the view direction and height the world space height
+float fogVisibility(float viewDepth, float height) {
+    float visibility = clamp(exp(-pow(viewDepth * fogDensity, fogGradient)), 0, 1);
+    float fogFactor = pow(clamp((height - minHeightFog) / (maxHeightFog - minHeightFog), 0, 1), 2);
+
+    return mix(visibility, 1, fogFactor);
+}
+
+vec3 tonemap(vec3 hdrColor) {
+    return vec3(1) - exp(-hdrColor * 0.7);
+}
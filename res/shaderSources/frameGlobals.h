@@ -0,0 +1,28 @@
+#ifndef FRAME_GLOBALS_H
+#define FRAME_GLOBALS_H
+#include "bindUtils.h"
+
+// Camera and time of the frame, written once per frame in flight by
+// FrameGlobals. Declare the globalsBind push constant before including
+SSB(globals, {
+    mat4 view;
+    mat4 projection;
+    mat4 projView;
+    mat4 invView;
+    mat4 invProjection;
+    mat4 invProjView;
+    vec3 camPos;
+    float time;
+    // Normalized
+    vec3 camDir;
+    // Clip space offset of the scene passes, see Checkerboard
+    vec2 jitter;
+});
+
+// Clip space position in the scene passes
+vec4 sceneClip(vec4 world) {
+    vec4 clip = GET(globals).projView * world;
+    clip.xy += GET(globals).jitter * clip.w;
+    return clip;
+}
+#endif
@@ -0,0 +1,21 @@
+// GGX importance sampling shared by the environment bake shaders, needs pbr.h
+
+#define PI 3.14159265359
+
+vec2 hammersley(uint i, uint count) {
+    return vec2(float(i) / float(count), float(bitfieldReverse(i)) * 2.3283064365386963e-10);
+}
+
+// Half vector around N distributed with the GGX lobe of the given roughness
+vec3 importanceSampleGGX(vec2 xi, vec3 N, float roughness) {
+    float alpha = roughness * roughness;
+    float phi = 2.0 * PI * xi.x;
+    float cosTheta = sqrt((1.0 - xi.y) / (1.0 + (alpha * alpha - 1.0) * xi.y));
+    float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+
+    vec3 up = abs(N.z) < 0.999 ? vec3(0, 0, 1) : vec3(1, 0, 0);
+    vec3 tangent = normalize(cross(up, N));
+    vec3 bitangent = cross(N, tangent);
+
+    return normalize(tangent * cos(phi) * sinTheta + bitangent * sin(phi) * sinTheta + N * cosTheta);
+}
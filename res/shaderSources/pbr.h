@@ -76,6 +76,42 @@ vec3 brdfMicrofacet(in vec3 L, in vec3 V, in vec3 N, in float metallic, in float
     return (diff + spec );
 }
 
+// Cheaper stand in for brdfMicrofacet, normalized Blinn-Phong with the
+// exponent matched to the GGX roughness and Kelemen's visibility term
+vec3 brdfBlinnPhong(in vec3 L, in vec3 V, in vec3 N, in float roughness, in vec3 baseColor,
+                    in float f0f) {
+    vec3 H = normalize(V + L);
+
+    float NoV = clamp(dot(N, V), 0.0, 1.0);
+    float NoH = clamp(dot(N, H), 0.0, 1.0);
+    float VoH = clamp(dot(V, H), 0.0, 1.0);
+
+    float alpha = roughness * roughness;
+    float shininess = max(2.0 / max(alpha * alpha, 0.0001) - 2.0, 1.0);
+
+    vec3 F = fresnelSchlick(NoV, vec3(f0f));
+    float D = (shininess + 2.0) * RECIPROCAL_2PI * pow(NoH, shininess);
+
+    vec3 spec = F * D / max(4.0 * VoH * VoH, 0.001);
+    vec3 diff = baseColor * (vec3(1.0) - F) * RECIPROCAL_PI;
+
+    return diff + spec;
+}
+
+// Split sum ambient term, prefiltered is the environment sampled at the
+// roughness level and envBRDF the scale and bias from the BRDF lookup table
+vec3 brdfAmbientSplitSum(in vec3 V, in vec3 N, in vec3 baseColor, in vec3 prefiltered, in vec2 envBRDF,
+                         in float f0f) {
+    vec3 f0 = vec3(f0f);
+    vec3 kD = 1.0 - fresnelSchlick(max(dot(N, V), 0.0), f0);
+
+    vec3 diffuse = baseColor * 0.2;
+
+    vec3 specular = prefiltered * (f0 * envBRDF.x + envBRDF.y);
+
+    return kD * diffuse + specular;
+}
+
 vec3 brdfAmbient(in vec3 L, in vec3 V, in vec3 N, in float metallic, in float roughness, in vec3 baseColor,
                     in vec3 reflection, in float f0f) {
 
@@ -3,6 +3,7 @@
 
 #include "postprocess.h"
 #include "globalData.h"
+#include "fog.h"
 
 layout (location = 0) in vec2 uv;
 
@@ -10,32 +11,22 @@ layout (location = 0) out vec4 color;
 
 layout(binding = 0) uniform sampler2D textures[];
 
-const float density = 0.005;
-const float gradient = 2.5;
-
-const float minHeightFog = 0.5;
-const float maxHeightFog = 100;
-
-const vec4 fogColor = vec4(1) * lightStrength;
-
 void main() {
-    float rawDepth = texture(textures[depth], uv).r;
-    vec4 viewCoords = invProj * vec4(uv.x * 2 - 1, uv.y * 2 -1, rawDepth, 1);
-    viewCoords /= viewCoords.w;
+    // The scene only covers uvScale of the source textures, keep bilinear
+    // taps from reading outside of it
+    vec2 halfTexel = 0.5 / vec2(textureSize(textures[source], 0));
+    vec2 sourceUv = min(uv * uvScale, uvScale - halfTexel);
 
-    float h = (invView * viewCoords).y;
+    float rawDepth = texture(textures[depth], sourceUv).r;
+    vec4 viewCoords = GET(globals).invProjection * vec4(uv.x * 2 - 1, uv.y * 2 -1, rawDepth, 1);
+    viewCoords /= viewCoords.w;
 
-    float fogVisibility = clamp(exp(-pow(-viewCoords.z*density, gradient)), 0, 1);
-    float fogFactor = pow(clamp((h - minHeightFog) / (maxHeightFog - minHeightFog), 0, 1), 2);
+    float h = (GET(globals).invView * viewCoords).y;
 
-    float visibility = mix(fogVisibility, 1, fogFactor);
+    float visibility = fogVisibility(-viewCoords.z, h);
 
-    vec4 t = texture(textures[source], uv);
+    vec4 t = texture(textures[source], sourceUv);
     vec3 hdrColor = mix(fogColor, t, visibility).rgb;
 
-    //Tonemapping
-
-    vec3 mapped = vec3(1) -exp(-hdrColor * 0.7);
-
-    color = vec4(mapped, 1);
-}
\ No newline at end of file
+    color = vec4(tonemap(hdrColor), 1);
+}
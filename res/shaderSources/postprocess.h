@@ -1,6 +1,8 @@
 layout (push_constant) uniform constants {
-    mat4 invProj;
-    mat4 invView;
+    vec2 uvScale;
+    uint globalsBind;
     uint depth;
     uint source;
-};
\ No newline at end of file
+};
+
+#include "frameGlobals.h"
\ No newline at end of file
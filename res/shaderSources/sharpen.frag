@@ -0,0 +1,48 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Contrast adaptive sharpening modeled after FSR1's RCAS pass, the negative
+// lobe is limited so that the 5 tap cross never clips to black or white
+
+layout (location = 0) in vec2 uv;
+
+layout (location = 0) out vec4 color;
+
+layout(binding = 0) uniform sampler2D textures[];
+
+layout(push_constant) uniform constants {
+    uint source;
+    float sharpness;
+};
+
+const float RCAS_LIMIT = 0.25 - 1.0 / 16.0;
+
+vec3 fetch(ivec2 p) {
+    p = clamp(p, ivec2(0), textureSize(textures[source], 0) - 1);
+    return texelFetch(textures[source], p, 0).rgb;
+}
+
+void main() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+
+    //   b
+    // d e f
+    //   h
+    vec3 b = fetch(p + ivec2(0, -1));
+    vec3 d = fetch(p + ivec2(-1, 0));
+    vec3 e = fetch(p);
+    vec3 f = fetch(p + ivec2(1, 0));
+    vec3 h = fetch(p + ivec2(0, 1));
+
+    vec3 mn4 = min(min(b, d), min(f, h));
+    vec3 mx4 = max(max(b, d), max(f, h));
+
+    vec3 hitMin = mn4 / max(4.0 * mx4, 1.0 / 65536.0);
+    vec3 hitMax = (1.0 - mx4) / min(4.0 * mn4 - 4.0, -1.0 / 65536.0);
+    vec3 lobeRGB = max(-hitMin, hitMax);
+    float lobe = max(-RCAS_LIMIT, min(max(lobeRGB.r, max(lobeRGB.g, lobeRGB.b)), 0)) * sharpness;
+
+    vec3 result = (lobe * (b + d + f + h) + e) / (4.0 * lobe + 1.0);
+
+    color = vec4(result, 1);
+}
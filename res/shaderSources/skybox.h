@@ -0,0 +1,7 @@
+layout(push_constant) uniform constants {
+    uint globalsBind;
+    uint skyboxTexture;
+    float intensity;
+};
+
+#include "frameGlobals.h"
\ No newline at end of file
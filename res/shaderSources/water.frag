@@ -5,6 +5,7 @@
 
 #include "pbr.h"
 #include "globalData.h"
+#include "fog.h"
 #include "water.h"
 
 layout (location = 0) in vec3 vNorm;
@@ -13,21 +14,12 @@ layout (location = 1) in vec3 worldPos;
 layout (location = 0) out vec4 color;
 
 layout(binding = 0) uniform samplerCube textures[];
+layout(binding = 0) uniform sampler2D lutTextures[];
 
-const float shininess = 50.0;
+#include "waterShading.h"
 
 void main() { 
-    vec3 norm = WaterNormal(worldPos);
-    vec3 camDir = normalize(camPos - worldPos);
-    vec3 halfway = normalize(-lightDir + camDir);
+    float viewDepth = -(GET(globals).view * vec4(worldPos, 1)).z;
 
-    vec3 reflected = texture(textures[skyboxTexture], reflect(-camDir, norm)).xyz * lightStrength;
-
-    vec3 waterColor = GET(material).diffuseColor.rgb;
-
-
-    vec3 colorLight = brdfMicrofacet(-lightDir, camDir, norm, 0, GET(material).roughness, waterColor, GET(material).baseReflectivity);
-    vec3 colorAmbient = brdfAmbient(-lightDir, camDir, norm, 0, GET(material).roughness, waterColor, reflected, GET(material).baseReflectivity);
-
-    color = vec4(colorLight + colorAmbient, 1);
-}
\ No newline at end of file
+    color = vec4(shadeWater(worldPos, viewDepth, GET(globals).camPos, ambientTexture, brdfLutTexture, ambientMaxLod), 1);
+}
@@ -17,33 +17,54 @@ SSB(material, {
     float baseReflectivity;
 
     float roughness;
+
+    float exponent;
 });
 
+// Shaders that only evaluate the waves declare their own push constants with
+// materialBind and globalsBind
+#ifndef WATER_CUSTOM_CONSTANTS
 layout (push_constant) uniform constants {
-    mat4 projView;
-    mat4 view;
-    vec3 camPos;
-    uint skyboxTexture;
+    uint globalsBind;
     uint materialBind;
-    float time;
+    uint ambientTexture;
+    uint brdfLutTexture;
+    float ambientMaxLod;
 };
+#endif
+
+#include "frameGlobals.h"
+
+// Specialized per WaterRenderer variant, the defaults handle any material.
+// The wave loops run up to WAVE_COUNT times, exact variants are only used when
+// numFreqs equals it so the loops have a constant trip count and can be
+// unrolled. A WAVE_COUNT of 0 runs numFreqs times without a bound, a
+// WAVE_EXPONENT of 0 reads the exponent from the material.
+layout(constant_id = 0) const uint WAVE_COUNT = 0;
+layout(constant_id = 1) const bool WAVES_EXACT = false;
+layout(constant_id = 2) const float WAVE_EXPONENT = 0;
 
-const float k = 7;
+float waveExponent() {
+    return WAVE_EXPONENT > 0 ? WAVE_EXPONENT : GET(material).exponent;
+}
 
 float H(vec2 D, vec2 pos, float A, float w, float speed) {
-    return pow((sin(dot(D, pos) * w + time * speed) + 1) * 0.5, k) * 2 * A;
+    float k = waveExponent();
+    return pow((sin(dot(D, pos) * w + GET(globals).time * speed) + 1) * 0.5, k) * 2 * A;
 }
 
 float DHX(vec2 D, vec2 pos, float A, float w, float speed) {
+    float k = waveExponent();
     return k * D.x * w * A 
-        * pow((sin(dot(D, pos) * w + time * speed) + 1) * 0.5, k - 1)
-        * cos(dot(D, pos) * w + time * speed);
+        * pow((sin(dot(D, pos) * w + GET(globals).time * speed) + 1) * 0.5, k - 1)
+        * cos(dot(D, pos) * w + GET(globals).time * speed);
 }
 
 float DHY(vec2 D, vec2 pos, float A, float w, float speed) {
+    float k = waveExponent();
     return k * D.y * w * A 
-        * pow((sin(dot(D, pos) * w + time * speed) + 1) * 0.5, k - 1)
-        * cos(dot(D, pos) * w + time * speed);
+        * pow((sin(dot(D, pos) * w + GET(globals).time * speed) + 1) * 0.5, k - 1)
+        * cos(dot(D, pos) * w + GET(globals).time * speed);
 }
 
 float WaterHeight(vec3 position, out vec3 normal) {
@@ -55,7 +76,10 @@ float WaterHeight(vec3 position, out vec3 normal) {
     normal = vec3(0, 1, 0);
     float rand = 0;
     vec2 prevDerivative = vec2(0);
-    for(uint i = 0; i < GET(material).numFreqs; i++) {
+    for(uint i = 0; WAVE_COUNT == 0 || i < WAVE_COUNT; i++) {
+        if (!WAVES_EXACT && i >= GET(material).numFreqs) {
+            break;
+        }
         h += H(d, pos2d, a, w, GET(material).speed);
         prevDerivative.x = DHX(d, pos2d, a, w, GET(material).speed);
         prevDerivative.y = DHY(d, pos2d, a, w, GET(material).speed);
@@ -85,7 +109,10 @@ vec3 WaterNormal(vec3 position) {
     vec3 normal = vec3(0, 1, 0);
     float rand = 0;
     vec2 prevDerivative = vec2(0);
-    for(uint i = 0; i < GET(material).numFreqs; i++) {
+    for(uint i = 0; WAVE_COUNT == 0 || i < WAVE_COUNT; i++) {
+        if (!WAVES_EXACT && i >= GET(material).numFreqs) {
+            break;
+        }
         prevDerivative.x = DHX(d, pos2d, a, w, GET(material).speed);
         prevDerivative.y = DHY(d, pos2d, a, w, GET(material).speed);
 
@@ -101,4 +128,27 @@ vec3 WaterNormal(vec3 position) {
     }
 
     return normal = normalize(normal);
-}
\ No newline at end of file
+}
+
+// Height alone at an arbitrary time, only the first maxWaves waves are summed
+float WaveHeight(vec2 pos2d, float t, uint maxWaves) {
+    float a = GET(material).baseA;
+    float w = GET(material).baseW;
+    vec2 d = GET(material).baseD;
+    float h = 0;
+    float rand = 0;
+    uint waves = min(GET(material).numFreqs, maxWaves);
+    float k = waveExponent();
+    for(uint i = 0; i < waves; i++) {
+        h += pow((sin(dot(d, pos2d) * w + t * GET(material).speed) + 1) * 0.5, k) * 2 * a;
+
+        rand = fract(sin(rand * 1.130812123312 +3.13873) * 4234234.23423023 + rand);
+
+        d = normalize (-d + vec2(-rand, rand) *0.5);
+
+        a *= GET(material).aMult;
+        w *= GET(material).wMult;
+    }
+
+    return h;
+}
@@ -0,0 +1,45 @@
+// Lighting shared by the forward and deferred water passes, needs pbr.h,
+// globalData.h, fog.h, water.h, a samplerCube textures[] and a sampler2D
+// lutTextures[] array. Passes that evaluate the normal differently define
+// WATER_NORMAL before including.
+
+#ifndef WATER_NORMAL
+#define WATER_NORMAL(position) WaterNormal(position)
+#endif
+
+// viewDepth is the distance along the view direction, as used by the fog.
+// ambient is the prefiltered environment, its level ambientMaxLod holds
+// roughness 1
+vec3 shadeWater(vec3 worldPos, float viewDepth, vec3 eye, uint ambient, uint brdfLut, float ambientMaxLod) {
+    vec3 camDir = normalize(eye - worldPos);
+    vec3 waterColor = GET(material).diffuseColor.rgb;
+    float f0 = GET(material).baseReflectivity;
+    float roughness = GET(material).roughness;
+    // Explicit lods as compute shaders have no derivatives
+    float ambientLod = roughness * ambientMaxLod;
+
+    float visibility = fogVisibility(viewDepth, worldPos.y);
+
+    // Mostly fog, blend the sky seen from a flat surface with the water
+    // colour
+    if (visibility < farShadingVisibility) {
+        vec3 sky = textureLod(textures[ambient], reflect(-camDir, vec3(0, 1, 0)), ambientLod).xyz * lightStrength;
+        float F = fresnelSchlick(clamp(camDir.y, 0, 1), vec3(f0)).x;
+        return mix(waterColor * 0.2, sky, F);
+    }
+
+    vec3 norm = WATER_NORMAL(worldPos);
+
+    vec3 prefiltered = textureLod(textures[ambient], reflect(-camDir, norm), ambientLod).xyz * lightStrength;
+    vec2 envBRDF = textureLod(lutTextures[brdfLut], vec2(max(dot(norm, camDir), 0), roughness), 0).xy;
+
+    vec3 colorLight;
+    if (visibility < fullShadingVisibility) {
+        colorLight = brdfBlinnPhong(-lightDir, camDir, norm, roughness, waterColor, f0);
+    } else {
+        colorLight = brdfMicrofacet(-lightDir, camDir, norm, 0, roughness, waterColor, f0);
+    }
+    vec3 colorAmbient = brdfAmbientSplitSum(camDir, norm, waterColor, prefiltered, envBRDF, f0);
+
+    return colorLight + colorAmbient;
+}
@@ -0,0 +1,468 @@
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+WaterMaterial materialFromPreset(const std::string &preset) {
+  if (preset == "open_sea") {
+    return openSeaMaterial();
+  }
+  if (preset == "calm_lake") {
+    return calmLakeMaterial();
+  }
+  throw std::runtime_error("Unknown material preset: " + preset);
+}
+
+double average(const std::vector<double> &values) {
+  if (values.empty()) {
+    return 0;
+  }
+  double sum = 0;
+  for (auto v : values) {
+    sum += v;
+  }
+  return sum / values.size();
+}
+
+Percentiles computePercentiles(std::vector<double> values) {
+  Percentiles ret;
+  ret.count = values.size();
+  if (values.empty()) {
+    return ret;
+  }
+  std::sort(values.begin(), values.end());
+
+  // Nearest rank
+  auto rank = [&](double p) {
+    auto index = (size_t)std::ceil(p / 100.0 * values.size());
+    return values[std::clamp<size_t>(index, 1, values.size()) - 1];
+  };
+  ret.p50 = rank(50);
+  ret.p95 = rank(95);
+  ret.p99 = rank(99);
+  ret.mean = average(values);
+  return ret;
+}
+
+void writePercentiles(std::ostream &out, const Percentiles &p) {
+  out << "{\"p50\": " << p.p50 << ", \"p95\": " << p.p95
+      << ", \"p99\": " << p.p99 << ", \"mean\": " << p.mean
+      << ", \"samples\": " << p.count << "}";
+}
+
+// Baseline files separate fields by whitespace
+std::string metricName(std::string name) {
+  std::replace(name.begin(), name.end(), ' ', '_');
+  return name;
+}
+
+bool endsWith(const std::string &text, const std::string &suffix) {
+  return text.size() >= suffix.size() &&
+         text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void addPercentiles(std::map<std::string, double> &metrics,
+                    const std::string &prefix, const Percentiles &p) {
+  if (p.count == 0) {
+    return;
+  }
+  metrics[prefix + ".p50"] = p.p50;
+  metrics[prefix + ".p95"] = p.p95;
+  metrics[prefix + ".p99"] = p.p99;
+}
+} // namespace
+
+BenchmarkScript BenchmarkScript::load(const std::string &path) {
+  auto data = file::readBinary(path);
+  std::istringstream in(std::string(data.begin(), data.end()));
+
+  BenchmarkScript script;
+  std::string line;
+  uint32_t lineNumber = 0;
+  while (std::getline(in, line)) {
+    lineNumber++;
+    auto comment = line.find('#');
+    if (comment != std::string::npos) {
+      line.resize(comment);
+    }
+
+    std::istringstream words(line);
+    std::string command;
+    if (!(words >> command)) {
+      continue;
+    }
+
+    bool ok = true;
+    if (command == "frames") {
+      ok = (bool)(words >> script.frames);
+    } else if (command == "timestep") {
+      ok = (bool)(words >> script.timestep);
+    } else if (command == "warmup") {
+      ok = (bool)(words >> script.warmup);
+    } else if (command == "scene") {
+      auto &event = script.scenes.emplace_back();
+      ok = (bool)(words >> event.frame >> event.value);
+    } else if (command == "material") {
+      auto &event = script.materials.emplace_back();
+      ok = (bool)(words >> event.frame >> event.value);
+      if (ok) {
+        materialFromPreset(event.value);
+      }
+    } else if (command == "waves") {
+      auto &event = script.waves.emplace_back();
+      ok = (bool)(words >> event.frame >> event.value);
+    } else if (command == "camera") {
+      auto &key = script.camera.emplace_back();
+      ok = (bool)(words >> key.frame >> key.position.x >> key.position.y >>
+                  key.position.z >> key.dir.x >> key.dir.y >> key.dir.z);
+      key.dir = glm::normalize(key.dir);
+    } else {
+      ok = false;
+    }
+
+    if (!ok) {
+      throw std::runtime_error("Invalid benchmark command at " + path + ":" +
+                               std::to_string(lineNumber));
+    }
+  }
+
+  auto byFrame = [](const auto &a, const auto &b) { return a.frame < b.frame; };
+  std::stable_sort(script.scenes.begin(), script.scenes.end(), byFrame);
+  std::stable_sort(script.camera.begin(), script.camera.end(), byFrame);
+  std::stable_sort(script.materials.begin(), script.materials.end(), byFrame);
+  std::stable_sort(script.waves.begin(), script.waves.end(), byFrame);
+
+  return script;
+}
+
+Benchmark::Benchmark(const std::string &scriptPath)
+    : scriptPath(scriptPath), script(BenchmarkScript::load(scriptPath)) {
+  samples.resize(script.frames);
+}
+
+void Benchmark::getCamera(uint32_t frame, glm::vec3 &position,
+                          glm::vec3 &dir) const {
+  if (script.camera.empty()) {
+    return;
+  }
+
+  auto next = std::find_if(script.camera.begin(), script.camera.end(),
+                           [&](const auto &key) { return key.frame > frame; });
+  if (next == script.camera.begin()) {
+    position = next->position;
+    dir = next->dir;
+    return;
+  }
+  auto prev = next - 1;
+  if (next == script.camera.end()) {
+    position = prev->position;
+    dir = prev->dir;
+    return;
+  }
+
+  float t = float(frame - prev->frame) / float(next->frame - prev->frame);
+  position = glm::mix(prev->position, next->position, t);
+  dir = glm::normalize(glm::mix(prev->dir, next->dir, t));
+}
+
+WaterMaterial Benchmark::getMaterial(uint32_t frame) const {
+  WaterMaterial material = openSeaMaterial();
+  uint32_t materialFrame = 0;
+  for (auto &event : script.materials) {
+    if (event.frame > frame) {
+      break;
+    }
+    material = materialFromPreset(event.value);
+    materialFrame = event.frame;
+  }
+
+  // A wave count override only lasts until the next preset switch
+  for (auto &event : script.waves) {
+    if (event.frame > frame) {
+      break;
+    }
+    if (event.frame >= materialFrame) {
+      material.numFreqs = event.value;
+    }
+  }
+  return material;
+}
+
+std::string Benchmark::getScene(uint32_t frame) const {
+  std::string scene = "default";
+  for (auto &event : script.scenes) {
+    if (event.frame > frame) {
+      break;
+    }
+    scene = event.value;
+  }
+  return scene;
+}
+
+void Benchmark::recordCpuFrame(uint32_t frame, double ms) {
+  if (frame < samples.size()) {
+    samples[frame].hasCpu = true;
+    samples[frame].cpuMs = ms;
+  }
+}
+
+void Benchmark::recordGpuFrame(const val::FrameProfile &profile) {
+  if (profile.valid && profile.frame < samples.size()) {
+    samples[profile.frame].gpu = profile;
+  }
+}
+
+void Benchmark::recordAllocations(uint32_t frame,
+                                  const val::AllocationStats &stats) {
+  if (frame < samples.size()) {
+    samples[frame].allocations = stats.total() - lastAllocations;
+  }
+  lastAllocations = stats.total();
+}
+
+std::vector<Benchmark::SceneReport> Benchmark::buildReport() const {
+  struct SceneSamples {
+    std::vector<double> cpu;
+    std::vector<double> gpu;
+    std::vector<double> allocations;
+    std::map<std::string, std::vector<double>> passes;
+    std::map<std::string, std::vector<val::PipelineStatistics>> statistics;
+  };
+
+  // Keep scenes in script order
+  std::vector<std::string> sceneOrder;
+  std::map<std::string, SceneSamples> scenes;
+
+  for (uint32_t frame = script.warmup; frame < samples.size(); frame++) {
+    auto name = getScene(frame);
+    if (!scenes.count(name)) {
+      sceneOrder.push_back(name);
+    }
+    auto &scene = scenes[name];
+    auto &sample = samples[frame];
+
+    if (sample.hasCpu) {
+      scene.cpu.push_back(sample.cpuMs);
+      scene.allocations.push_back(sample.allocations);
+    }
+    if (!sample.gpu.valid) {
+      continue;
+    }
+    if (!sample.gpu.scopes.empty()) {
+      scene.gpu.push_back(sample.gpu.gpuFrameMs);
+    }
+    for (auto &pass : sample.gpu.scopes) {
+      if (pass.name != "frame") {
+        scene.passes[pass.name].push_back(pass.gpuMs);
+      }
+    }
+    for (auto &stats : sample.gpu.statistics) {
+      scene.statistics[stats.name].push_back(stats);
+    }
+  }
+
+  std::vector<SceneReport> report;
+  for (auto &name : sceneOrder) {
+    auto &scene = scenes[name];
+    auto &ret = report.emplace_back();
+    ret.name = name;
+    ret.cpu = computePercentiles(scene.cpu);
+    ret.gpu = computePercentiles(scene.gpu);
+    ret.allocationsPerFrame = average(scene.allocations);
+    for (auto &[pass, values] : scene.passes) {
+      ret.passes[pass] = computePercentiles(values);
+    }
+
+    // Counters are averaged per frame
+    for (auto &[pass, values] : scene.statistics) {
+      auto &averages = ret.statistics[pass];
+      for (auto &stats : values) {
+        averages.patches += stats.tessellationPatches;
+        averages.tessellationInvocations += stats.tessellationInvocations;
+        averages.fragmentInvocations += stats.fragmentInvocations;
+        averages.primitives += stats.clippingPrimitives;
+      }
+      averages.patches /= values.size();
+      averages.tessellationInvocations /= values.size();
+      averages.fragmentInvocations /= values.size();
+      averages.primitives /= values.size();
+    }
+  }
+  return report;
+}
+
+std::map<std::string, double> Benchmark::getMetrics() const {
+  std::map<std::string, double> metrics;
+  for (auto &scene : buildReport()) {
+    addPercentiles(metrics, scene.name + ".cpu_ms", scene.cpu);
+    addPercentiles(metrics, scene.name + ".gpu_ms", scene.gpu);
+    for (auto &[pass, values] : scene.passes) {
+      addPercentiles(metrics, scene.name + ".passes." + metricName(pass),
+                     values);
+    }
+    for (auto &[pass, stats] : scene.statistics) {
+      auto prefix = scene.name + ".statistics." + metricName(pass);
+      metrics[prefix + ".patches"] = stats.patches;
+      metrics[prefix + ".tessellation_invocations"] =
+          stats.tessellationInvocations;
+      metrics[prefix + ".fragment_invocations"] = stats.fragmentInvocations;
+      metrics[prefix + ".primitives"] = stats.primitives;
+    }
+    metrics[scene.name + ".allocations_per_frame"] = scene.allocationsPerFrame;
+  }
+  return metrics;
+}
+
+void Benchmark::writeReport(const std::string &path,
+                            const char *deviceName) const {
+  std::ofstream out(path);
+  if (!out.is_open()) {
+    throw std::runtime_error("Cannot write benchmark report: " + path);
+  }
+
+  out << "{\n";
+  out << "  \"script\": \"" << scriptPath << "\",\n";
+  out << "  \"device\": \"" << deviceName << "\",\n";
+  out << "  \"frames\": " << script.frames << ",\n";
+  out << "  \"warmup\": " << script.warmup << ",\n";
+  out << "  \"timestep\": " << script.timestep << ",\n";
+  out << "  \"scenes\": [";
+
+  auto report = buildReport();
+  for (size_t i = 0; i < report.size(); i++) {
+    auto &scene = report[i];
+    out << (i ? ",\n" : "\n");
+    out << "    {\n";
+    out << "      \"name\": \"" << scene.name << "\",\n";
+    out << "      \"cpu_ms\": ";
+    writePercentiles(out, scene.cpu);
+    out << ",\n      \"gpu_ms\": ";
+    writePercentiles(out, scene.gpu);
+
+    out << ",\n      \"passes\": {";
+    bool first = true;
+    for (auto &[name, values] : scene.passes) {
+      out << (first ? "\n" : ",\n") << "        \"" << name << "\": ";
+      writePercentiles(out, values);
+      first = false;
+    }
+    out << "\n      },\n";
+
+    out << "      \"statistics\": {";
+    first = true;
+    for (auto &[name, stats] : scene.statistics) {
+      out << (first ? "\n" : ",\n") << "        \"" << name << "\": {"
+          << "\"patches\": " << stats.patches
+          << ", \"tessellation_invocations\": "
+          << stats.tessellationInvocations
+          << ", \"fragment_invocations\": " << stats.fragmentInvocations
+          << ", \"primitives\": " << stats.primitives << "}";
+      first = false;
+    }
+    out << "\n      },\n";
+    out << "      \"allocations_per_frame\": " << scene.allocationsPerFrame
+        << "\n";
+    out << "    }";
+  }
+  out << "\n  ]\n}\n";
+}
+
+void Benchmark::writeBaseline(const std::string &path) const {
+  std::ofstream out(path);
+  if (!out.is_open()) {
+    throw std::runtime_error("Cannot write benchmark baseline: " + path);
+  }
+
+  out << "# Generated from " << scriptPath << "\n";
+  for (auto &[name, value] : getMetrics()) {
+    out << name << " " << value << "\n";
+  }
+}
+
+bool Benchmark::compareBaseline(const std::string &path,
+                                double defaultTolerance) const {
+  std::ifstream in(path);
+  if (!in.is_open()) {
+    throw std::runtime_error("Cannot read benchmark baseline: " + path);
+  }
+
+  auto metrics = getMetrics();
+  bool passed = true;
+  std::string line;
+  while (std::getline(in, line)) {
+    auto comment = line.find('#');
+    if (comment != std::string::npos) {
+      line.resize(comment);
+    }
+
+    std::istringstream words(line);
+    std::string name;
+    double baseline;
+    if (!(words >> name >> baseline)) {
+      continue;
+    }
+
+    double tolerance = defaultTolerance;
+    std::string toleranceWord;
+    if (words >> toleranceWord) {
+      tolerance = std::stod(toleranceWord);
+    }
+
+    auto it = metrics.find(name);
+    if (it == metrics.end()) {
+      printf("MISSING %s\n", name.c_str());
+      passed = false;
+      continue;
+    }
+
+    // Every metric is lower is better, only increases are regressions
+    double limit = baseline * (1.0 + tolerance / 100.0);
+    bool ok = it->second <= limit;
+    printf("%s %s: %g (baseline %g, limit %g)\n", ok ? "OK  " : "FAIL",
+           name.c_str(), it->second, baseline, limit);
+    passed = passed && ok;
+  }
+  return passed;
+}
+
+bool Benchmark::checkReference(const std::string &dir,
+                               const char *deviceName) const {
+  std::string name;
+  for (const char *c = deviceName; *c; c++) {
+    name += std::isalnum((unsigned char)*c) ? (char)std::tolower(*c) : '_';
+  }
+  auto path = dir + "/" + name + ".txt";
+  if (std::filesystem::exists(path)) {
+    return compareBaseline(path, 0);
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(dir, error);
+  std::ofstream out(path);
+  if (!out.is_open()) {
+    throw std::runtime_error("Cannot write benchmark reference: " + path);
+  }
+
+  // Counters only change with the work submitted, timings are noisier
+  out << "# Reference of " << deviceName << " for " << scriptPath
+      << ", commit it to gate later runs on this device\n";
+  for (auto &[metric, value] : getMetrics()) {
+    if (endsWith(metric, ".tessellation_invocations") ||
+        endsWith(metric, ".fragment_invocations")) {
+      out << metric << " " << value << " 2\n";
+    } else if (endsWith(metric, ".p50") &&
+               (metric.find(".gpu_ms.") != std::string::npos ||
+                metric.find(".passes.") != std::string::npos)) {
+      out << metric << " " << value << " 15\n";
+    }
+  }
+  printf("Recorded benchmark reference %s\n", path.c_str());
+  return true;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "WaterRenderer.hpp"
+
+// Scripted benchmark, every command is keyed by the frame it takes effect on:
+//   frames <count>            total frames to render
+//   timestep <seconds>        simulated time advanced every frame
+//   warmup <count>            frames excluded from the report
+//   scene <frame> <name>      starts a new report section
+//   camera <frame> <px> <py> <pz> <dx> <dy> <dz>
+//                             camera keyframe, interpolated linearly
+//   material <frame> <preset> switches to "open_sea" or "calm_lake"
+//   waves <frame> <count>     overrides the number of waves
+struct BenchmarkScript {
+  template <typename T> struct Event {
+    uint32_t frame{};
+    T value{};
+  };
+
+  struct CameraKey {
+    uint32_t frame{};
+    glm::vec3 position{};
+    glm::vec3 dir{0, 0, 1};
+  };
+
+  uint32_t frames = 600;
+  float timestep = 1.f / 60.f;
+  uint32_t warmup = 0;
+
+  std::vector<Event<std::string>> scenes;
+  std::vector<CameraKey> camera;
+  std::vector<Event<std::string>> materials;
+  std::vector<Event<uint32_t>> waves;
+
+  static BenchmarkScript load(const std::string &path);
+};
+
+struct Percentiles {
+  double p50{}, p95{}, p99{}, mean{};
+  size_t count{};
+};
+
+class Benchmark {
+private:
+  struct FrameSample {
+    bool hasCpu{};
+    double cpuMs{};
+    uint64_t allocations{};
+    val::FrameProfile gpu;
+  };
+
+  struct StatisticsAverages {
+    double patches{};
+    double tessellationInvocations{};
+    double fragmentInvocations{};
+    double primitives{};
+  };
+
+  struct SceneReport {
+    std::string name;
+    Percentiles cpu;
+    Percentiles gpu;
+    std::map<std::string, Percentiles> passes;
+    std::map<std::string, StatisticsAverages> statistics;
+    double allocationsPerFrame{};
+  };
+
+  std::string scriptPath;
+  BenchmarkScript script;
+  std::vector<FrameSample> samples;
+  uint64_t lastAllocations{};
+
+  std::vector<SceneReport> buildReport() const;
+  // Flattened "scene.group.name" metrics, all of them lower is better
+  std::map<std::string, double> getMetrics() const;
+
+public:
+  Benchmark(const std::string &scriptPath);
+
+  uint32_t getFrameCount() const { return script.frames; }
+  float getTimestep() const { return script.timestep; }
+
+  void getCamera(uint32_t frame, glm::vec3 &position, glm::vec3 &dir) const;
+  WaterMaterial getMaterial(uint32_t frame) const;
+  std::string getScene(uint32_t frame) const;
+
+  void recordCpuFrame(uint32_t frame, double ms);
+  void recordGpuFrame(const val::FrameProfile &profile);
+  void recordAllocations(uint32_t frame, const val::AllocationStats &stats);
+
+  void writeReport(const std::string &path, const char *deviceName) const;
+
+  // Baseline files hold one "metric value [tolerance%]" entry per line,
+  // metrics missing from the file are not checked
+  void writeBaseline(const std::string &path) const;
+  // Returns false when any metric exceeds its baseline by more than the
+  // tolerance, defaultTolerance is a percentage
+  bool compareBaseline(const std::string &path, double defaultTolerance) const;
+
+  // Baseline of the device dependent metrics, the tessellation and fragment
+  // invocations and the median GPU times, in a file per device in dir. The
+  // first run on a device records it and passes, later runs compare
+  bool checkReference(const std::string &dir, const char *deviceName) const;
+};
@@ -0,0 +1,155 @@
+#include "Checkerboard.hpp"
+
+struct ResolvePushConstants {
+  glm::mat4 prevProjView;
+  val::BindPoint<val::Texture> color;
+  val::BindPoint<val::Texture> depth;
+  val::BindPoint<val::Texture> history;
+  val::BindPoint<val::StorageBuffer> material;
+  glm::uvec2 fullSize;
+  glm::vec2 historyUvScale;
+  val::BindPoint<val::StorageBuffer> globals;
+  float prevTime;
+  uint32_t parity;
+  uint32_t historyValid;
+};
+
+static Size halfSize(Size size) { return {(size.w + 1) / 2, (size.h + 1) / 2}; }
+
+Checkerboard::Checkerboard(val::Engine &engine, Size fullSize,
+                           val::TextureFormat colorFormat)
+    : engine(engine) {
+  file::MappedFile vertShader("shaders/fullscreen.vert.spv");
+  file::MappedFile fragShader("shaders/checkerboard.frag.spv");
+
+  val::PipelineBuilder builder(engine);
+  pipeline = builder.setPushConstant<ResolvePushConstants>()
+                 .addColorAttachment(colorFormat)
+                 .addColorAttachment(val::TextureFormat::R32)
+                 .disableDepthTest()
+                 .addStage(vertShader.data(), val::ShaderStage::VERTEX)
+                 .addStage(fragShader.data(), val::ShaderStage::FRAGMENT)
+                 .fillTriangles()
+                 .build();
+
+  colorSamples = engine.createMultisampledTexture(
+      halfSize(fullSize), colorFormat, CHECKERBOARD_SAMPLES);
+  depthSamples = engine.createMultisampledTexture(
+      halfSize(fullSize), val::TextureFormat::DEPTH32, CHECKERBOARD_SAMPLES);
+  for (auto &h : history) {
+    h = engine.createTexture(fullSize, colorFormat,
+                             val::TextureSampler::LINEAR);
+  }
+  depth = engine.createTexture(fullSize, val::TextureFormat::R32);
+}
+
+Checkerboard::~Checkerboard() {
+  engine.freeTexture(colorSamples);
+  engine.freeTexture(depthSamples);
+  engine.freeTexture(history[0]);
+  engine.freeTexture(history[1]);
+  engine.freeTexture(depth);
+}
+
+void Checkerboard::begin(RenderState &rs) {
+  if (!enabled) {
+    historyValid = false;
+    return;
+  }
+
+  auto &cmd = *rs.cmd;
+
+  // Reprojecting across a resolution change would sample the wrong area
+  if (rs.renderSize.w != prevRenderSize.w ||
+      rs.renderSize.h != prevRenderSize.h) {
+    historyValid = false;
+  }
+
+  renderSize = rs.renderSize;
+
+  // Odd frames shift the image one output pixel to the left so the samples
+  // cover the other diagonal
+  Size half = halfSize(renderSize);
+  rs.jitter = {(frame & 1) ? -1.f / half.w : 0.f, 0.f};
+
+  rs.colorBuffer = colorSamples;
+  rs.depthBuffer = depthSamples;
+  rs.renderSize = half;
+
+  cmd.transitionTexture(colorSamples, vk::ImageLayout::eUndefined,
+                        vk::ImageLayout::eColorAttachmentOptimal);
+  cmd.transitionTexture(depthSamples, vk::ImageLayout::eUndefined,
+                        vk::ImageLayout::eDepthAttachmentOptimal);
+}
+
+void Checkerboard::resolve(RenderState &rs,
+                           val::BindPoint<val::StorageBuffer> material) {
+  if (!enabled) {
+    return;
+  }
+
+  auto &cmd = *rs.cmd;
+  auto cmdb = cmd.cmd;
+
+  auto target = history[frame & 1];
+  auto previous = history[(frame + 1) & 1];
+
+  cmd.transitionTexture(colorSamples, vk::ImageLayout::eColorAttachmentOptimal,
+                        vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                        vk::ImageLayout::eShaderReadOnlyOptimal,
+                        vk::PipelineStageFlagBits2::eFragmentShader);
+  cmd.transitionTexture(depthSamples, vk::ImageLayout::eDepthAttachmentOptimal,
+                        vk::PipelineStageFlagBits2::eLateFragmentTests,
+                        vk::ImageLayout::eShaderReadOnlyOptimal,
+                        vk::PipelineStageFlagBits2::eFragmentShader);
+  cmd.transitionTexture(target, vk::ImageLayout::eUndefined,
+                        vk::ImageLayout::eColorAttachmentOptimal);
+  cmd.transitionTexture(depth, vk::ImageLayout::eUndefined,
+                        vk::ImageLayout::eColorAttachmentOptimal);
+
+  Size half = halfSize(renderSize);
+  glm::mat4 projView = rs.projectionMatrix * rs.viewMatrix;
+
+  ResolvePushConstants pc;
+  pc.prevProjView = prevProjView;
+  pc.color = colorSamples->bindPoint;
+  pc.depth = depthSamples->bindPoint;
+  pc.history = previous->bindPoint;
+  pc.material = material;
+  pc.fullSize = {half.w * 2, half.h * 2};
+  pc.historyUvScale =
+      glm::vec2(prevRenderSize.w, prevRenderSize.h) /
+      glm::vec2(previous->size.w, previous->size.h);
+  pc.globals = rs.globals;
+  pc.prevTime = prevTime;
+  pc.parity = frame & 1;
+  pc.historyValid = historyValid;
+
+  val::Texture *targets[2] = {target, depth};
+  cmd.beginPass(targets, nullptr, false, renderSize);
+  cmd.bindPipeline(pipeline);
+  cmd.pushConstants(pipeline, pc);
+  cmd.setViewport({0, 0, renderSize.w, renderSize.h});
+  cmdb.draw(6, 1, 0, 0);
+  cmd.endPass();
+
+  cmd.transitionTexture(target, vk::ImageLayout::eColorAttachmentOptimal,
+                        vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                        vk::ImageLayout::eShaderReadOnlyOptimal,
+                        vk::PipelineStageFlagBits2::eAllCommands);
+  cmd.transitionTexture(depth, vk::ImageLayout::eColorAttachmentOptimal,
+                        vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                        vk::ImageLayout::eShaderReadOnlyOptimal,
+                        vk::PipelineStageFlagBits2::eAllCommands);
+
+  rs.colorBuffer = target;
+  rs.depthBuffer = depth;
+  rs.renderSize = renderSize;
+  rs.jitter = {};
+
+  prevProjView = projView;
+  prevTime = rs.time;
+  prevRenderSize = renderSize;
+  historyValid = true;
+  frame++;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "types.hpp"
+
+// Shades half of the pixels each frame in a checkerboard pattern. The scene is
+// rendered into half resolution 2x MSAA targets with per sample shading and a
+// projection jitter that alternates the covered diagonal every frame, resolve
+// rebuilds the full resolution image by reprojecting the previous one.
+class Checkerboard {
+private:
+  val::Engine &engine;
+  val::GraphicsPipeline pipeline;
+
+  val::Texture *colorSamples{};
+  val::Texture *depthSamples{};
+  // Resolved frames, alternating between output and history
+  val::Texture *history[2]{};
+  // Full resolution depth for the passes after the resolve
+  val::Texture *depth{};
+
+  uint32_t frame = 0;
+  bool historyValid = false;
+  Size renderSize{};
+  Size prevRenderSize{};
+  glm::mat4 prevProjView{};
+  float prevTime = 0;
+
+public:
+  bool enabled = false;
+
+  Checkerboard(val::Engine &engine, Size fullSize,
+               val::TextureFormat colorFormat = val::TextureFormat::RGBA16);
+  ~Checkerboard();
+
+  // Redirects rs to the half resolution targets with this frame's jitter,
+  // the global constants are written afterwards
+  void begin(RenderState &rs);
+  // Rebuilds full resolution colour and depth, rs points to them afterwards
+  void resolve(RenderState &rs, val::BindPoint<val::StorageBuffer> material);
+};
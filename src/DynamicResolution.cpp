@@ -0,0 +1,39 @@
+#include "DynamicResolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Frame time band around the target in which the scale is left alone
+constexpr float DEADBAND = 0.05f;
+// Fraction of the correction applied per frame, GPU times arrive a couple of
+// frames late so correcting all at once overshoots
+constexpr float RESPONSE = 0.15f;
+// Render sizes are rounded to this many pixels to avoid constant tiny changes
+constexpr uint32_t SIZE_GRANULARITY = 8;
+
+void DynamicResolution::update(const val::FrameProfile &profile) {
+  if (!enabled || !profile.valid || profile.gpuFrameMs <= 0 ||
+      profile.frame == lastFrame) {
+    return;
+  }
+  lastFrame = profile.frame;
+
+  float ms = (float)profile.gpuFrameMs;
+  if (std::abs(ms - targetMs) < targetMs * DEADBAND) {
+    return;
+  }
+
+  // Most of the frame cost scales with the pixel count, that is scale^2
+  float desired = scale * std::sqrt(targetMs / ms);
+  scale += (desired - scale) * RESPONSE;
+  scale = std::clamp(scale, minScale, maxScale);
+}
+
+Size DynamicResolution::getRenderSize() const {
+  auto fit = [&](uint32_t full) {
+    auto size = (uint32_t)(full * getScale());
+    size = (size + SIZE_GRANULARITY / 2) / SIZE_GRANULARITY * SIZE_GRANULARITY;
+    return std::clamp<uint32_t>(size, SIZE_GRANULARITY, full);
+  };
+  return {fit(fullSize.w), fit(fullSize.h)};
+}
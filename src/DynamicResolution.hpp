@@ -0,0 +1,26 @@
+#pragma once
+
+#include "types.hpp"
+
+// Scales the internal render resolution so the GPU frame time converges to a
+// target. Render targets are allocated at full size and the scene is drawn
+// into their top left sub-rectangle, PostProcess upscales it with filtering.
+class DynamicResolution {
+private:
+  Size fullSize;
+  float scale = 1.f;
+  uint32_t lastFrame = UINT32_MAX;
+
+public:
+  bool enabled = false;
+  float targetMs = 16.f;
+  float minScale = 0.5f;
+  float maxScale = 1.f;
+
+  DynamicResolution(Size fullSize) : fullSize(fullSize) {}
+
+  void update(const val::FrameProfile &profile);
+
+  float getScale() const { return enabled ? scale : 1.f; }
+  Size getRenderSize() const;
+};
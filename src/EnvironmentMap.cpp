@@ -0,0 +1,299 @@
+#include "EnvironmentMap.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+
+#include "val/helpers.hpp"
+
+// Bump when the bake output changes so stale cache files are ignored
+constexpr uint32_t BAKE_VERSION = 1;
+constexpr uint32_t CACHE_MAGIC = 0x4c424949; // "IIBL"
+
+constexpr uint32_t MAX_PREFILTERED_SIZE = 256;
+// Roughness 1 at 8x8 for a 256 base level
+constexpr uint32_t PREFILTERED_LEVELS = 6;
+constexpr uint32_t BRDF_LUT_SIZE = 256;
+constexpr uint32_t BAKE_TILE_SIZE = 8;
+
+struct CacheHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t key;
+  uint32_t prefilteredSize;
+  uint32_t prefilteredLevels;
+  uint32_t brdfLutSize;
+  uint32_t padding;
+};
+
+struct PrefilterPushConstants {
+  val::BindPoint<val::Texture> source;
+  val::BindPoint<val::StorageImage> destination;
+  uint32_t size;
+  float roughness;
+  float intensity;
+  uint32_t firstFace;
+};
+
+struct BrdfLutPushConstants {
+  val::BindPoint<val::StorageImage> destination;
+  uint32_t size;
+};
+
+static uint32_t tiles(uint32_t size) {
+  return (size + BAKE_TILE_SIZE - 1) / BAKE_TILE_SIZE;
+}
+
+EnvironmentMap::EnvironmentMap(val::Engine &engine, val::BufferWriter &writer,
+                               val::GpuScheduler &scheduler,
+                               val::Texture *skybox, uint64_t skyboxHash)
+    : engine(engine), scheduler(scheduler), source(skybox) {
+  uint32_t size = std::min(skybox->size.w, MAX_PREFILTERED_SIZE);
+  uint32_t levels =
+      std::min<uint32_t>(PREFILTERED_LEVELS, std::bit_width(size));
+  prefiltered =
+      engine.createCubemap({size, size}, val::TextureFormat::RGBA16,
+                           val::TextureSampler::LINEAR, levels,
+                           VK_IMAGE_USAGE_STORAGE_BIT);
+  refreshTarget =
+      engine.createCubemap({size, size}, val::TextureFormat::RGBA16,
+                           val::TextureSampler::LINEAR, levels,
+                           VK_IMAGE_USAGE_STORAGE_BIT);
+  // RGBA16 as two channel formats are not guaranteed storage support
+  brdfLut = engine.createTexture({BRDF_LUT_SIZE, BRDF_LUT_SIZE},
+                                 val::TextureFormat::RGBA16,
+                                 val::TextureSampler::LINEAR, 1,
+                                 VK_IMAGE_USAGE_STORAGE_BIT);
+
+  cacheKey = hash::fnv1a(skyboxHash);
+  cacheKey = hash::fnv1a(BAKE_VERSION, cacheKey);
+  cacheKey = hash::fnv1a(size, cacheKey);
+  cacheKey = hash::fnv1a(levels, cacheKey);
+  cacheKey = hash::fnv1a(BRDF_LUT_SIZE, cacheKey);
+  char name[64];
+  snprintf(name, sizeof(name), "cache/ibl_%016llx.bin",
+           (unsigned long long)cacheKey);
+  cachePath = name;
+
+  if (loadCache(writer)) {
+    needsBake = false;
+    return;
+  }
+
+  buildPipelines();
+
+  prefilteredReadback =
+      engine.createReadbackBuffer(val::helpers::getTextureLevelsSize(
+          prefiltered->size, prefiltered->format, prefiltered->layers,
+          prefiltered->mipLevels));
+  brdfLutReadback = engine.createReadbackBuffer(
+      val::helpers::getTextureSizeFromSizeAndFormat(brdfLut->size,
+                                                    brdfLut->format));
+}
+
+EnvironmentMap::~EnvironmentMap() {
+  // Exiting before update wrote the cache would bake again on the next
+  // launch, so wait for the bake here instead
+  if (prefilteredReadback && !needsBake) {
+    engine.waitFinishAllCommands();
+    writeCache();
+  }
+  if (prefilteredReadback) {
+    engine.destroyCpuBuffer(prefilteredReadback);
+    engine.destroyCpuBuffer(brdfLutReadback);
+  }
+  engine.freeTexture(prefiltered);
+  engine.freeTexture(refreshTarget);
+  engine.freeTexture(brdfLut);
+}
+
+void EnvironmentMap::buildPipelines() {
+  if (pipelinesBuilt) {
+    return;
+  }
+  pipelinesBuilt = true;
+
+  file::MappedFile prefilterShader("shaders/prefilter.comp.spv");
+  val::ComputePipelineBuilder prefilterBuilder(engine);
+  prefilterPipeline = prefilterBuilder.setShader(prefilterShader.data())
+                          .setPushConstant<PrefilterPushConstants>()
+                          .build();
+
+  file::MappedFile brdfLutShader("shaders/brdflut.comp.spv");
+  val::ComputePipelineBuilder brdfLutBuilder(engine);
+  brdfLutPipeline = brdfLutBuilder.setShader(brdfLutShader.data())
+                        .setPushConstant<BrdfLutPushConstants>()
+                        .build();
+}
+
+bool EnvironmentMap::loadCache(val::BufferWriter &writer) {
+  if (!file::exists(cachePath)) {
+    return false;
+  }
+
+  file::MappedFile cache(cachePath);
+  auto data = cache.data();
+  auto prefilteredBytes = val::helpers::getTextureLevelsSize(
+      prefiltered->size, prefiltered->format, prefiltered->layers,
+      prefiltered->mipLevels);
+  auto brdfLutBytes = val::helpers::getTextureSizeFromSizeAndFormat(
+      brdfLut->size, brdfLut->format);
+  if (data.size() != sizeof(CacheHeader) + prefilteredBytes + brdfLutBytes) {
+    return false;
+  }
+
+  CacheHeader header;
+  memcpy(&header, data.data(), sizeof(CacheHeader));
+  if (header.magic != CACHE_MAGIC || header.version != BAKE_VERSION ||
+      header.key != cacheKey ||
+      header.prefilteredSize != prefiltered->size.w ||
+      header.prefilteredLevels != prefiltered->mipLevels ||
+      header.brdfLutSize != brdfLut->size.w) {
+    return false;
+  }
+
+  auto prefilteredData = data.data() + sizeof(CacheHeader);
+  writer.enqueueTextureLevelsWrite(prefiltered, prefilteredData);
+  writer.enqueueTextureLevelsWrite(brdfLut, prefilteredData + prefilteredBytes);
+  return true;
+}
+
+void EnvironmentMap::writeCache() {
+  CacheHeader header{.magic = CACHE_MAGIC,
+                     .version = BAKE_VERSION,
+                     .key = cacheKey,
+                     .prefilteredSize = prefiltered->size.w,
+                     .prefilteredLevels = prefiltered->mipLevels,
+                     .brdfLutSize = brdfLut->size.w};
+
+  std::vector<uint8_t> data(sizeof(CacheHeader) + prefilteredReadback->size +
+                            brdfLutReadback->size);
+  memcpy(data.data(), &header, sizeof(CacheHeader));
+  auto prefilteredData = data.data() + sizeof(CacheHeader);
+  engine.readCPUBuffer(prefilteredReadback, prefilteredData,
+                       prefilteredReadback->size);
+  engine.readCPUBuffer(brdfLutReadback,
+                       prefilteredData + prefilteredReadback->size,
+                       brdfLutReadback->size);
+
+  // A missing cache only costs a bake on the next launch
+  if (!file::writeBinary(cachePath, data)) {
+    printf("Cannot write environment cache %s\n", cachePath.c_str());
+  }
+
+  engine.destroyCpuBuffer(prefilteredReadback);
+  engine.destroyCpuBuffer(brdfLutReadback);
+  prefilteredReadback = nullptr;
+  brdfLutReadback = nullptr;
+}
+
+void EnvironmentMap::update(val::CommandBuffer &cmd) {
+  if (needsBake) {
+    bake(cmd);
+    needsBake = false;
+    return;
+  }
+
+  // The frame fence of the bake has been waited on once every frame in
+  // flight has been started again
+  if (prefilteredReadback && ++framesSinceBake >= val::FRAMES_IN_FLIGHT) {
+    writeCache();
+  }
+}
+
+void EnvironmentMap::setSkyIntensity(float intensity) {
+  if (intensity == skyIntensity) {
+    return;
+  }
+  skyIntensity = intensity;
+  buildPipelines();
+
+  // One face of one level per slice, the finish swaps the refiltered map in.
+  // A refresh still running is cancelled without its swap, so the map jumps
+  // straight to the latest intensity
+  scheduler.submit(
+      "environment refresh", refreshTarget->mipLevels * 6,
+      [this, intensity](val::CommandBuffer &cmd, uint32_t slice) {
+        if (slice == 0) {
+          cmd.transitionTextureLevels(
+              refreshTarget, vk::ImageLayout::eUndefined,
+              vk::PipelineStageFlagBits2::eAllCommands,
+              vk::ImageLayout::eGeneral,
+              vk::PipelineStageFlagBits2::eComputeShader);
+        }
+        prefilterFaces(cmd, refreshTarget, slice / 6, slice % 6, 1, intensity);
+      },
+      [this](val::CommandBuffer &cmd) {
+        cmd.transitionTextureLevels(
+            refreshTarget, vk::ImageLayout::eGeneral,
+            vk::PipelineStageFlagBits2::eComputeShader,
+            vk::ImageLayout::eShaderReadOnlyOptimal,
+            vk::PipelineStageFlagBits2::eAllCommands);
+        std::swap(prefiltered, refreshTarget);
+      });
+}
+
+void EnvironmentMap::prefilterFaces(val::CommandBuffer &cmd,
+                                    val::Texture *target, uint32_t level,
+                                    uint32_t firstFace, uint32_t faces,
+                                    float intensity) {
+  PrefilterPushConstants pc;
+  pc.source = source->bindPoint;
+  pc.destination = target->mipStorageBindPoints[level];
+  pc.size = val::helpers::getMipSize(target->size, level).w;
+  pc.roughness = level / std::max(getMaxLod(), 1.f);
+  pc.intensity = intensity;
+  pc.firstFace = firstFace;
+
+  cmd.bindPipeline(prefilterPipeline);
+  cmd.pushConstants(prefilterPipeline, pc);
+  cmd.cmd.dispatch(tiles(pc.size), tiles(pc.size), faces);
+}
+
+void EnvironmentMap::bake(val::CommandBuffer &cmd) {
+  cmd.beginProfile("environment bake");
+
+  cmd.transitionTextureLevels(prefiltered, vk::ImageLayout::eUndefined,
+                              vk::PipelineStageFlagBits2::eAllCommands,
+                              vk::ImageLayout::eGeneral,
+                              vk::PipelineStageFlagBits2::eComputeShader);
+  cmd.transitionTextureLevels(brdfLut, vk::ImageLayout::eUndefined,
+                              vk::PipelineStageFlagBits2::eAllCommands,
+                              vk::ImageLayout::eGeneral,
+                              vk::PipelineStageFlagBits2::eComputeShader);
+
+  // Every level reads the source skybox, so they are independent. The cache
+  // is defined at intensity 1, a different one is refreshed afterwards
+  for (uint32_t level = 0; level < prefiltered->mipLevels; level++) {
+    prefilterFaces(cmd, prefiltered, level, 0, 6, 1.f);
+  }
+
+  BrdfLutPushConstants lutPc;
+  lutPc.destination = brdfLut->storageBindPoint;
+  lutPc.size = brdfLut->size.w;
+  cmd.bindPipeline(brdfLutPipeline);
+  cmd.pushConstants(brdfLutPipeline, lutPc);
+  cmd.cmd.dispatch(tiles(lutPc.size), tiles(lutPc.size), 1);
+
+  for (auto texture : {prefiltered, brdfLut}) {
+    cmd.transitionTextureLevels(texture, vk::ImageLayout::eGeneral,
+                                vk::PipelineStageFlagBits2::eComputeShader,
+                                vk::ImageLayout::eTransferSrcOptimal,
+                                vk::PipelineStageFlagBits2::eTransfer);
+  }
+  cmd.copyTextureLevelsToBuffer(prefiltered, prefilteredReadback);
+  cmd.copyTextureLevelsToBuffer(brdfLut, brdfLutReadback);
+  cmd.memoryBarrier(vk::PipelineStageFlagBits2::eTransfer,
+                    vk::AccessFlagBits2::eTransferWrite,
+                    vk::PipelineStageFlagBits2::eHost,
+                    vk::AccessFlagBits2::eHostRead);
+  for (auto texture : {prefiltered, brdfLut}) {
+    cmd.transitionTextureLevels(texture, vk::ImageLayout::eTransferSrcOptimal,
+                                vk::PipelineStageFlagBits2::eTransfer,
+                                vk::ImageLayout::eShaderReadOnlyOptimal,
+                                vk::PipelineStageFlagBits2::eAllCommands);
+  }
+
+  cmd.endProfile();
+}
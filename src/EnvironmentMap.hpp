@@ -0,0 +1,59 @@
+#pragma once
+
+#include "types.hpp"
+
+// Split sum image based lighting for the skybox: a specular cubemap whose mip
+// levels are prefiltered for increasing roughness and the BRDF lookup table
+// indexed by (NoV, roughness). Both are baked in compute on the first frame
+// and cached in res/cache, keyed by the skybox contents, so later launches
+// only upload them. The cache holds the map at sky intensity 1, other
+// intensities are refiltered in the background through the GPU scheduler.
+class EnvironmentMap {
+private:
+  val::Engine &engine;
+  val::GpuScheduler &scheduler;
+  val::ComputePipeline prefilterPipeline;
+  val::ComputePipeline brdfLutPipeline;
+  val::Texture *source;
+  val::Texture *prefiltered;
+  val::Texture *brdfLut;
+  // Refreshes are filtered into this one a face and level at a time, then it
+  // is swapped with prefiltered
+  val::Texture *refreshTarget;
+  bool pipelinesBuilt = false;
+  float skyIntensity = 1.f;
+
+  std::string cachePath;
+  uint64_t cacheKey;
+  bool needsBake = true;
+  // Filled by the bake, written to the cache once that frame has finished
+  val::CPUBuffer *prefilteredReadback{};
+  val::CPUBuffer *brdfLutReadback{};
+  uint32_t framesSinceBake = 0;
+
+  bool loadCache(val::BufferWriter &writer);
+  void writeCache();
+  void buildPipelines();
+  void prefilterFaces(val::CommandBuffer &cmd, val::Texture *target,
+                      uint32_t level, uint32_t firstFace, uint32_t faces,
+                      float intensity);
+  void bake(val::CommandBuffer &cmd);
+
+public:
+  EnvironmentMap(val::Engine &engine, val::BufferWriter &writer,
+                 val::GpuScheduler &scheduler, val::Texture *skybox,
+                 uint64_t skyboxHash);
+  ~EnvironmentMap();
+
+  // Call every frame after the pending writes have been recorded
+  void update(val::CommandBuffer &cmd);
+
+  // Scales the sky radiance, the current map stays in use until the refilter
+  // scheduled for the new value completes
+  void setSkyIntensity(float intensity);
+
+  val::Texture *getPrefiltered() { return prefiltered; }
+  val::Texture *getBrdfLut() { return brdfLut; }
+  // Level sampled at roughness 1
+  float getMaxLod() const { return float(prefiltered->mipLevels - 1); }
+};
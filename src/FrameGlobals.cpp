@@ -0,0 +1,30 @@
+#include "FrameGlobals.hpp"
+
+FrameGlobals::FrameGlobals(val::Engine &engine)
+    : engine(engine), buffers(engine, [&](uint32_t) {
+        return engine.createHostStorageBuffer(sizeof(GlobalConstants));
+      }) {}
+
+FrameGlobals::~FrameGlobals() {
+  for (auto buffer : buffers) {
+    engine.destroyStorageBuffer(buffer);
+  }
+}
+
+void FrameGlobals::update(RenderState &rs) {
+  GlobalConstants constants{};
+  constants.view = rs.viewMatrix;
+  constants.projection = rs.projectionMatrix;
+  constants.projView = rs.projectionMatrix * rs.viewMatrix;
+  constants.invView = glm::inverse(rs.viewMatrix);
+  constants.invProjection = glm::inverse(rs.projectionMatrix);
+  constants.invProjView = constants.invView * constants.invProjection;
+  constants.camPos = rs.camPos;
+  constants.time = rs.time;
+  constants.camDir = glm::normalize(rs.camDir);
+  constants.jitter = rs.jitter;
+
+  auto buffer = buffers.get();
+  engine.writeStorageBuffer(buffer, &constants, 0, sizeof(GlobalConstants));
+  rs.globals = buffer->bindPoint;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "types.hpp"
+
+// Matches frameGlobals.h
+struct GlobalConstants {
+  glm::mat4 view;
+  glm::mat4 projection;
+  glm::mat4 projView;
+  glm::mat4 invView;
+  glm::mat4 invProjection;
+  glm::mat4 invProjView;
+  glm::vec3 camPos;
+  float time;
+  glm::vec3 camDir;
+  float padding;
+  glm::vec2 jitter;
+};
+
+// Camera and time shared by every pass of a frame. One host visible buffer
+// per frame in flight, written once per frame, passes push its bind point
+// instead of their own copies of the matrices
+class FrameGlobals {
+private:
+  val::Engine &engine;
+  val::PerFrame<val::StorageBuffer *> buffers;
+
+public:
+  FrameGlobals(val::Engine &engine);
+  ~FrameGlobals();
+
+  // Writes the constants of the frame being recorded from rs and points
+  // rs.globals at them, call after Checkerboard::begin
+  void update(RenderState &rs);
+};
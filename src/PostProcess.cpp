@@ -1,42 +1,245 @@
 #include "PostProcess.hpp"
 
+#include <cmath>
+
 struct PushConstants {
-  glm::mat4 invProj;
-  glm::mat4 invView;
+  // Fraction of the source textures covered by the rendered scene
+  glm::vec2 uvScale;
+  val::BindPoint<val::StorageBuffer> globals;
+  val::BindPoint<val::Texture> depth;
+  val::BindPoint<val::Texture> source;
+};
+
+struct ComputePushConstants {
+  glm::vec2 uvScale;
+  glm::uvec2 outputSize;
+  val::BindPoint<val::StorageBuffer> globals;
   val::BindPoint<val::Texture> depth;
   val::BindPoint<val::Texture> source;
-  float pad[2];
+  val::BindPoint<val::StorageImage> destination;
 };
 
-PostProcess::PostProcess(val::Engine &engine) : engine(engine) {
-  auto vertShader = file::readBinary("shaders/postprocess.vert.spv");
-  auto fragShader = file::readBinary("shaders/postprocess.frag.spv");
+constexpr uint32_t TILE_SIZE = 16;
+
+struct UpscalePushConstants {
+  val::BindPoint<val::Texture> source;
+  val::BindPoint<val::StorageImage> destination;
+  glm::uvec2 inputSize;
+  glm::uvec2 outputSize;
+};
+
+struct SharpenPushConstants {
+  val::BindPoint<val::Texture> source;
+  float sharpness;
+};
+
+PostProcess::PostProcess(val::Engine &engine, ShaderLibrary &shaders,
+                         val::TextureFormat outputFormat)
+    : engine(engine), shaders(shaders), outputFormat(outputFormat) {
+  buildPipelines();
+}
+
+PostProcess::~PostProcess() {
+  if (tonemapped) {
+    engine.freeTexture(tonemapped);
+    engine.freeTexture(upscaled);
+  }
+}
+
+// Freed textures live until the frames using them have finished
+static void resize(val::Engine &engine, val::Texture *&texture, Size size) {
+  if (texture && texture->size.w == size.w && texture->size.h == size.h) {
+    return;
+  }
+  if (texture) {
+    engine.freeTexture(texture);
+  }
+  texture = engine.createTexture(size, val::TextureFormat::RGBA16,
+                                 val::TextureSampler::NEAREST, 1,
+                                 VK_IMAGE_USAGE_STORAGE_BIT);
+}
+
+void PostProcess::resizeIntermediates(Size sourceSize, Size outputSize) {
+  resize(engine, tonemapped, sourceSize);
+  resize(engine, upscaled, outputSize);
+}
+
+void PostProcess::buildPipelines() {
+  auto vertShader = shaders.load("postprocess.vert");
+  auto fragShader = shaders.load("postprocess.frag");
 
   val::PipelineBuilder builder(engine);
   pipeline = builder.setPushConstant<PushConstants>()
-                 .addColorAttachment(val::TextureFormat::RGBA16)
+                 .addColorAttachment(outputFormat)
                  .disableDepthTest()
                  .addStage(std::span(vertShader), val::ShaderStage::VERTEX)
                  .addStage(std::span(fragShader), val::ShaderStage::FRAGMENT)
                  .fillTriangles()
                  .build();
+
+  val::PipelineBuilder intermediateBuilder(engine);
+  intermediatePipeline =
+      intermediateBuilder.setPushConstant<PushConstants>()
+          .addColorAttachment(val::TextureFormat::RGBA16)
+          .disableDepthTest()
+          .addStage(std::span(vertShader), val::ShaderStage::VERTEX)
+          .addStage(std::span(fragShader), val::ShaderStage::FRAGMENT)
+          .fillTriangles()
+          .build();
+
+  auto computeShader = shaders.load("postprocess.comp");
+  val::ComputePipelineBuilder computeBuilder(engine);
+  computeBuilder.setShader(computeShader)
+      .setPushConstant<ComputePushConstants>();
+  computePipeline[0] =
+      computeBuilder.setSpecializationConstant(0, VkBool32(false)).build();
+  computePipeline[1] =
+      computeBuilder.setSpecializationConstant(0, VkBool32(true)).build();
+
+  auto upscaleShader = shaders.load("upscale.comp");
+  val::ComputePipelineBuilder cpBuild(engine);
+  upscalePipeline = cpBuild.setShader(upscaleShader)
+                        .setPushConstant<UpscalePushConstants>()
+                        .build();
+
+  auto fullscreenShader = shaders.load("fullscreen.vert");
+  auto sharpenShader = shaders.load("sharpen.frag");
+
+  val::PipelineBuilder sharpenBuilder(engine);
+  sharpenPipeline =
+      sharpenBuilder.setPushConstant<SharpenPushConstants>()
+          .addColorAttachment(outputFormat)
+          .disableDepthTest()
+          .addStage(std::span(fullscreenShader), val::ShaderStage::VERTEX)
+          .addStage(std::span(sharpenShader), val::ShaderStage::FRAGMENT)
+          .fillTriangles()
+          .build();
 }
 
-void PostProcess::renderPostProcess(RenderState &rs, val::Texture *finalImage) {
+void PostProcess::reloadShaders() {
+  engine.destroyPipeline(pipeline);
+  engine.destroyPipeline(intermediatePipeline);
+  engine.destroyPipeline(computePipeline[0]);
+  engine.destroyPipeline(computePipeline[1]);
+  engine.destroyPipeline(upscalePipeline);
+  engine.destroyPipeline(sharpenPipeline);
+  buildPipelines();
+}
+
+void PostProcess::computeTonemap(RenderState &rs, val::Texture *target,
+                                 Size area) {
   auto &cmd = *rs.cmd;
   auto cmdb = cmd.cmd;
 
-  cmd.beginPass(std::span(&finalImage, 1));
+  cmd.transitionTexture(target, vk::ImageLayout::eUndefined,
+                        vk::ImageLayout::eGeneral);
+
+  ComputePushConstants pc;
+  pc.globals = rs.globals;
+  pc.depth = rs.depthBuffer->bindPoint;
+  pc.source = rs.colorBuffer->bindPoint;
+  pc.destination = target->storageBindPoint;
+  pc.uvScale = glm::vec2(rs.renderSize.w, rs.renderSize.h) /
+               glm::vec2(rs.colorBuffer->size.w, rs.colorBuffer->size.h);
+  pc.outputSize = {area.w, area.h};
+
+  auto &activePipeline = computePipeline[halfResFog];
+  cmd.bindPipeline(activePipeline);
+  cmd.pushConstants(activePipeline, pc);
+  cmdb.dispatch((area.w + TILE_SIZE - 1) / TILE_SIZE,
+                (area.h + TILE_SIZE - 1) / TILE_SIZE, 1);
+
+  // Leave the target as the graphics pass would
+  cmd.transitionTexture(target, vk::ImageLayout::eGeneral,
+                        vk::PipelineStageFlagBits2::eComputeShader,
+                        vk::ImageLayout::eColorAttachmentOptimal,
+                        vk::PipelineStageFlagBits2::eAllCommands);
+}
+
+void PostProcess::tonemap(RenderState &rs, val::Texture *target, Size area) {
+  auto &cmd = *rs.cmd;
+  auto cmdb = cmd.cmd;
+
+  // Named by path so profiles and benchmark reports show which one ran
+  if (useCompute && target->storage) {
+    cmd.beginProfile("tonemap_compute");
+    computeTonemap(rs, target, area);
+    cmd.endProfile();
+    return;
+  }
+
+  cmd.beginProfile("tonemap_graphics");
+  cmd.beginPass(std::span(&target, 1), nullptr, false, area);
   PushConstants pc;
-  pc.invProj = glm::inverse(rs.projectionMatrix);
-  pc.invView = glm::inverse(rs.viewMatrix);
+  pc.globals = rs.globals;
   pc.depth = rs.depthBuffer->bindPoint;
   pc.source = rs.colorBuffer->bindPoint;
+  pc.uvScale = glm::vec2(rs.renderSize.w, rs.renderSize.h) /
+               glm::vec2(rs.colorBuffer->size.w, rs.colorBuffer->size.h);
 
-  cmd.bindPipeline(pipeline);
-  cmd.pushConstants(pipeline, pc);
-  cmd.setViewport({0, 0, rs.colorBuffer->size.w, rs.colorBuffer->size.h});
+  auto &activePipeline = target == tonemapped ? intermediatePipeline : pipeline;
+  cmd.bindPipeline(activePipeline);
+  cmd.pushConstants(activePipeline, pc);
+  cmd.setViewport({0, 0, area.w, area.h});
   cmdb.draw(6, 1, 0, 0);
 
   cmd.endPass();
+  cmd.endProfile();
+}
+
+void PostProcess::upscale(RenderState &rs, val::Texture *finalImage) {
+  auto &cmd = *rs.cmd;
+  auto cmdb = cmd.cmd;
+
+  cmd.transitionTexture(tonemapped, vk::ImageLayout::eUndefined,
+                        vk::ImageLayout::eColorAttachmentOptimal);
+  tonemap(rs, tonemapped, rs.renderSize);
+
+  cmd.transitionTexture(tonemapped, vk::ImageLayout::eColorAttachmentOptimal,
+                        vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                        vk::ImageLayout::eShaderReadOnlyOptimal,
+                        vk::PipelineStageFlagBits2::eComputeShader);
+  cmd.transitionTexture(upscaled, vk::ImageLayout::eUndefined,
+                        vk::ImageLayout::eGeneral);
+
+  UpscalePushConstants upc;
+  upc.source = tonemapped->bindPoint;
+  upc.destination = upscaled->storageBindPoint;
+  upc.inputSize = {rs.renderSize.w, rs.renderSize.h};
+  upc.outputSize = {finalImage->size.w, finalImage->size.h};
+
+  cmd.bindPipeline(upscalePipeline);
+  cmd.pushConstants(upscalePipeline, upc);
+  cmdb.dispatch((finalImage->size.w + 7) / 8, (finalImage->size.h + 7) / 8, 1);
+
+  cmd.transitionTexture(upscaled, vk::ImageLayout::eGeneral,
+                        vk::PipelineStageFlagBits2::eComputeShader,
+                        vk::ImageLayout::eShaderReadOnlyOptimal,
+                        vk::PipelineStageFlagBits2::eFragmentShader);
+
+  cmd.beginPass(std::span(&finalImage, 1));
+  SharpenPushConstants spc;
+  spc.source = upscaled->bindPoint;
+  spc.sharpness = std::exp2(-sharpness);
+
+  cmd.bindPipeline(sharpenPipeline);
+  cmd.pushConstants(sharpenPipeline, spc);
+  cmd.setViewport({0, 0, finalImage->size.w, finalImage->size.h});
+  cmdb.draw(6, 1, 0, 0);
+
+  cmd.endPass();
+}
+
+void PostProcess::renderPostProcess(RenderState &rs, val::Texture *finalImage) {
+  bool scaled = rs.renderSize.w != finalImage->size.w ||
+                rs.renderSize.h != finalImage->size.h;
+
+  if (upscaler == Upscaler::EdgeAdaptive && scaled) {
+    // The swapchain extent can differ from the requested window size and
+    // changes when the swapchain is recreated
+    resizeIntermediates(rs.colorBuffer->size, finalImage->size);
+    upscale(rs, finalImage);
+  } else {
+    tonemap(rs, finalImage, finalImage->size);
+  }
 }
@@ -1,12 +1,59 @@
+#pragma once
+
+#include "ShaderLibrary.hpp"
 #include "types.hpp"
 
+enum class Upscaler {
+  // Bilinear filtering while tonemapping
+  Bilinear,
+  // Tonemap at render resolution, then edge adaptive upscaling and sharpening
+  EdgeAdaptive
+};
+
 class PostProcess {
 private:
   val::Engine &engine;
+  ShaderLibrary &shaders;
+  val::TextureFormat outputFormat;
+  // Tonemapping into the output format and into the RGBA16 intermediate
+  // used by the upscaler
   val::GraphicsPipeline pipeline;
+  val::GraphicsPipeline intermediatePipeline;
+  // Indexed by halfResFog, the full resolution one uses no shared memory
+  val::ComputePipeline computePipeline[2];
+  val::ComputePipeline upscalePipeline;
+  val::GraphicsPipeline sharpenPipeline;
+
+  val::Texture *tonemapped{};
+  val::Texture *upscaled{};
+
+  void buildPipelines();
+  // tonemapped holds any render size of the source, upscaled matches the
+  // final image exactly as the sharpening clamps to its size
+  void resizeIntermediates(Size sourceSize, Size outputSize);
+  void tonemap(RenderState &rs, val::Texture *target, Size area);
+  void computeTonemap(RenderState &rs, val::Texture *target, Size area);
+  void upscale(RenderState &rs, val::Texture *finalImage);
 
 public:
-  PostProcess(val::Engine &engine);
+  Upscaler upscaler = Upscaler::Bilinear;
+  // Sharpening amount in stops, 0 is the strongest
+  float sharpness = 0.2f;
+  // Fog and tonemapping in a tiled compute pass that writes the target as a
+  // storage image. Targets without storage usage, only the swapchain when
+  // rendering into it, use the graphics pass. The tonemap's profile scope
+  // names the path that ran
+  bool useCompute = true;
+  // Evaluate fog once per 2x2 block, only used by the compute pass
+  bool halfResFog = false;
+
+  PostProcess(val::Engine &engine, ShaderLibrary &shaders,
+              val::TextureFormat outputFormat = val::TextureFormat::RGBA16);
+  ~PostProcess();
+
+  // Rebuilds the pipelines from the current shader binaries, call between
+  // frames
+  void reloadShaders();
 
   void renderPostProcess(RenderState &rs, val::Texture *finalImage);
-};
\ No newline at end of file
+};
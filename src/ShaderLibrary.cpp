@@ -0,0 +1,215 @@
+#include "ShaderLibrary.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+constexpr auto WATCH_INTERVAL = std::chrono::milliseconds(250);
+
+static const std::string SOURCE_DIR = "shaderSources/";
+static const std::string CACHE_DIR = "cache/shaders/";
+
+// Appends the file and, depth first, everything it includes, each file once
+static void collectSources(const std::string &name,
+                           std::vector<std::string> &files,
+                           std::string &text) {
+  for (auto &file : files) {
+    if (file == name) {
+      return;
+    }
+  }
+  files.push_back(name);
+
+  std::ifstream stream(std::string(RESPATH) + SOURCE_DIR + name);
+  std::stringstream source;
+  source << stream.rdbuf();
+  text += source.str();
+
+  std::string line;
+  while (std::getline(source, line)) {
+    auto include = line.find("#include \"");
+    if (include == std::string::npos) {
+      continue;
+    }
+    auto start = include + 10;
+    auto end = line.find('"', start);
+    if (end != std::string::npos) {
+      collectSources(line.substr(start, end - start), files, text);
+    }
+  }
+}
+
+// Compiles through the cache, empty when the shader does not compile
+static std::optional<std::vector<uint8_t>> compile(const std::string &name) {
+  std::vector<std::string> files;
+  std::string text;
+  collectSources(name, files, text);
+
+  char key[32];
+  snprintf(key, sizeof(key), "%016llx",
+           (unsigned long long)hash::fnv1a(text.data(), text.size()));
+  auto cached = CACHE_DIR + name + "." + key + ".spv";
+  if (file::exists(cached)) {
+    return file::readBinary(cached);
+  }
+
+  std::string res = RESPATH;
+  std::error_code error;
+  fs::create_directories(res + CACHE_DIR, error);
+  // Written to a temporary file first so a half written binary is never
+  // picked up from the cache
+  auto output = res + cached + ".tmp";
+  auto log = res + CACHE_DIR + name + ".log";
+  auto command = "\"" + std::string(GLSLC_PATH) + "\" \"" + res + SOURCE_DIR +
+                 name + "\" -o \"" + output + "\" 2> \"" + log + "\"";
+#ifdef _WIN32
+  // cmd.exe strips the outer quotes
+  command = "\"" + command + "\"";
+#endif
+  if (std::system(command.c_str()) != 0) {
+    std::ifstream stream(log);
+    std::stringstream errors;
+    errors << stream.rdbuf();
+    printf("Shader %s failed to compile:\n%s\n", name.c_str(),
+           errors.str().c_str());
+    return std::nullopt;
+  }
+
+  fs::rename(output, res + cached, error);
+  if (error) {
+    return std::nullopt;
+  }
+  return file::readBinary(cached);
+}
+
+ShaderLibrary::ShaderLibrary(bool hotReload) : hotReload(hotReload) {
+  if (hotReload && std::string(GLSLC_PATH).find("NOTFOUND") !=
+                       std::string::npos) {
+    printf("glslc was not found at configure time, hot reload is disabled\n");
+    this->hotReload = false;
+  }
+  if (this->hotReload) {
+    watcher = std::thread([this] { watch(); });
+  }
+}
+
+ShaderLibrary::~ShaderLibrary() {
+  stopWatcher = true;
+  if (watcher.joinable()) {
+    watcher.join();
+  }
+}
+
+std::span<const uint8_t> ShaderLibrary::load(const std::string &name) {
+  auto binary = binaries.find(name);
+  if (binary != binaries.end()) {
+    return binary->second.data();
+  }
+
+  if (hotReload) {
+    // Taken before compiling so the watcher sees any later edit, even one
+    // made before its first scan
+    std::vector<std::string> files;
+    std::string text;
+    collectSources(name, files, text);
+    {
+      std::lock_guard lock(mutex);
+      watched.push_back(name);
+      for (auto &file : files) {
+        std::error_code error;
+        auto time = fs::last_write_time(
+            std::string(RESPATH) + SOURCE_DIR + file, error);
+        if (!error) {
+          writeTimes.try_emplace(file, time);
+        }
+      }
+    }
+    // Sources edited while the program was closed are compiled here, the
+    // prebuilt binary is the fallback when they do not compile
+    std::lock_guard compileLock(compileMutex);
+    if (auto spirv = compile(name)) {
+      binaries[name].compiled = std::move(*spirv);
+      return binaries[name].data();
+    }
+  }
+
+  auto &loaded = binaries[name];
+  loaded.mapped = file::MappedFile("shaders/" + name + ".spv");
+  return loaded.data();
+}
+
+bool ShaderLibrary::update() {
+  std::lock_guard lock(mutex);
+  if (compiled.empty()) {
+    return false;
+  }
+  for (auto &[name, spirv] : compiled) {
+    binaries[name] = {.compiled = std::move(spirv)};
+    printf("Reloaded shader %s\n", name.c_str());
+  }
+  compiled.clear();
+  return true;
+}
+
+void ShaderLibrary::watch() {
+  auto sourceDir = std::string(RESPATH) + SOURCE_DIR;
+
+  while (!stopWatcher) {
+    std::this_thread::sleep_for(WATCH_INTERVAL);
+
+    std::vector<std::pair<std::string, fs::file_time_type>> times;
+    std::error_code error;
+    for (auto &entry : fs::directory_iterator(sourceDir, error)) {
+      auto time = entry.last_write_time(error);
+      if (!error) {
+        times.emplace_back(entry.path().filename().string(), time);
+      }
+    }
+
+    std::vector<std::string> changed;
+    std::vector<std::string> shaders;
+    {
+      std::lock_guard lock(mutex);
+      for (auto &[name, time] : times) {
+        auto known = writeTimes.find(name);
+        if (known == writeTimes.end()) {
+          writeTimes[name] = time;
+        } else if (known->second != time) {
+          known->second = time;
+          changed.push_back(name);
+        }
+      }
+      shaders = watched;
+    }
+    if (changed.empty()) {
+      continue;
+    }
+
+    for (auto &shader : shaders) {
+      std::vector<std::string> files;
+      std::string text;
+      collectSources(shader, files, text);
+
+      bool affected = false;
+      for (auto &file : files) {
+        for (auto &name : changed) {
+          affected |= file == name;
+        }
+      }
+      if (!affected) {
+        continue;
+      }
+
+      std::lock_guard compileLock(compileMutex);
+      if (auto spirv = compile(shader)) {
+        std::lock_guard lock(mutex);
+        compiled.emplace_back(shader, std::move(*spirv));
+      }
+    }
+  }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "foundation/foundation.hpp"
+
+// Hands out SPIR-V by shader source name, e.g. "water.frag". By default the
+// binaries built by the Shaders target are used. With hot reload the sources
+// in res/shaderSources are compiled with glslc into res/cache/shaders, keyed
+// by a hash of the source and everything it includes, and a background
+// thread recompiles the shaders whose files change. Renderers pick up new
+// binaries when update() reports them, between frames.
+class ShaderLibrary {
+private:
+  // Prebuilt binaries stay mapped, compiled ones are owned
+  struct Binary {
+    file::MappedFile mapped;
+    std::vector<uint8_t> compiled;
+
+    std::span<const uint8_t> data() const {
+      return compiled.empty() ? mapped.data() : std::span(compiled);
+    }
+  };
+
+  bool hotReload;
+  // Latest binary of every loaded shader, only used on the main thread
+  std::unordered_map<std::string, Binary> binaries;
+
+  std::thread watcher;
+  std::atomic<bool> stopWatcher{false};
+  // Guards watched, writeTimes and compiled, shared with the watcher thread
+  std::mutex mutex;
+  std::vector<std::string> watched;
+  // Last seen modification time of every source file by name
+  std::unordered_map<std::string, std::filesystem::file_time_type> writeTimes;
+  std::vector<std::pair<std::string, std::vector<uint8_t>>> compiled;
+  // Held while compiling, load and the watcher write the same cache files
+  std::mutex compileMutex;
+
+  void watch();
+
+public:
+  ShaderLibrary(bool hotReload);
+  ~ShaderLibrary();
+
+  // The span is valid until update() returns true
+  std::span<const uint8_t> load(const std::string &name);
+
+  // Takes the binaries compiled since the last call, returns true when
+  // pipelines should be rebuilt. Call between frames.
+  bool update();
+};
@@ -1,5 +1,8 @@
 #include "SkyboxRenderer.hpp"
 
+#include <bit>
+#include <cstdio>
+
 glm::vec3 cubeVertices[6 * 4] = {
     // right face
     {1, 1, 1},
@@ -34,23 +37,50 @@ glm::vec3 cubeVertices[6 * 4] = {
 };
 
 struct PushConstants {
-  glm::mat4 projView;
-  glm::vec3 camPos;
+  val::BindPoint<val::StorageBuffer> globals;
   val::BindPoint<val::Texture> skybox;
+  float intensity;
 };
 
-SkyboxRenderer::SkyboxRenderer(val::Engine &engine, val::BufferWriter &writer)
-    : engine(engine) {
+SkyboxRenderer::SkyboxRenderer(val::Engine &engine,
+                               jobs::JobSystem &jobSystem,
+                               val::BufferWriter &writer,
+                               ShaderLibrary &shaders,
+                               val::TextureFormat colorFormat)
+    : engine(engine), jobSystem(jobSystem), shaders(shaders),
+      colorFormat(colorFormat), skyboxPass(engine) {
   std::string textures[6] = {
       "textures/skybox/right.bmp", "textures/skybox/left.bmp",
       "textures/skybox/top.bmp",   "textures/skybox/bottom.bmp",
       "textures/skybox/front.bmp", "textures/skybox/back.bmp"};
+  // Only the headers are read here, decoding happens on the workers
+  faceImages.reserve(6);
+  for (size_t i = 0; i < 6; i++) {
+    faceImages.emplace_back(textures[i]);
+  }
+
+  // Full mip chain so the environment prefilter can sample it without
+  // aliasing
+  auto faceSize = faceImages[0].size;
+  uint32_t mipLevels = std::bit_width(std::max(faceSize.w, faceSize.h));
+  skybox = engine.createCubemap(faceSize, val::TextureFormat::RGBA8,
+                                val::TextureSampler::LINEAR, mipLevels);
+
   for (size_t i = 0; i < 6; i++) {
-    auto image = file::loadImage(textures[i]);
-    if (!skybox) {
-      skybox = engine.createCubemap(image.size, val::TextureFormat::RGBA8);
-    }
-    writer.enqueueTextureWrite(skybox, image.data.data(), i);
+    // Each face decodes into its own staging buffer, the writer itself is
+    // only touched from this thread
+    auto staging = writer.mapTextureWrite(skybox, i);
+    jobSystem.run(
+        [this, i, staging, name = textures[i]] {
+          if (!faceImages[i].decode(staging)) {
+            printf("Cannot decode %s\n", name.c_str());
+          }
+          // Hashing the encoded file is as good a key and avoids reading
+          // back the write combined staging memory, packed images carry it
+          // precomputed
+          faceHashes[i] = faceImages[i].hash();
+        },
+        &faceLoads);
   }
 
   cube = engine.createMesh(6 * 4 * sizeof(glm::vec3), 6 * 6);
@@ -71,41 +101,72 @@ SkyboxRenderer::SkyboxRenderer(val::Engine &engine, val::BufferWriter &writer)
   writer.enqueueMeshWrite(cube, std::span(cubeVertices, 6 * 4),
                           std::span(indices, 6 * 6));
 
-  auto vertShader = file::readBinary("shaders/skybox.vert.spv");
-  auto fragShader = file::readBinary("shaders/skybox.frag.spv");
+  buildPipelines();
+}
+
+void SkyboxRenderer::buildPipelines() {
+  auto vertShader = shaders.load("skybox.vert");
+  auto fragShader = shaders.load("skybox.frag");
 
   val::PipelineBuilder builder(engine);
   pipeline = builder.setPushConstant<PushConstants>()
                  .addVertexInputAttribute(0, val::VertexInputFormat::FLOAT3)
-                 .addColorAttachment(val::TextureFormat::RGBA16)
+                 .addColorAttachment(colorFormat)
                  .disableDepthTest()
                  .addStage(std::span(vertShader), val::ShaderStage::VERTEX)
                  .addStage(std::span(fragShader), val::ShaderStage::FRAGMENT)
                  .fillTriangles()
                  .setVertexStride(sizeof(glm::vec3))
                  .build();
+  checkerboardPipeline =
+      builder.setSampleShading(CHECKERBOARD_SAMPLES).build();
+}
+
+void SkyboxRenderer::reloadShaders() {
+  skyboxPass.invalidate();
+  engine.destroyPipeline(pipeline);
+  engine.destroyPipeline(checkerboardPipeline);
+  buildPipelines();
+}
+
+void SkyboxRenderer::finishLoading() {
+  if (facesLoaded) {
+    return;
+  }
+  jobSystem.wait(faceLoads);
+  for (auto faceHash : faceHashes) {
+    sourceHash = hash::fnv1a(faceHash, sourceHash);
+  }
+  faceImages.clear();
+  facesLoaded = true;
 }
 
 SkyboxRenderer::~SkyboxRenderer() {
+  finishLoading();
   engine.destroyMesh(cube);
   engine.freeTexture(skybox);
 }
 
 void SkyboxRenderer::renderSkybox(RenderState &rs) {
-  auto &cmd = *rs.cmd;
-  auto cmdb = cmd.cmd;
-
-  cmd.beginPass(std::span(&rs.colorBuffer, 1));
   PushConstants pc;
-  pc.projView = rs.projectionMatrix * rs.viewMatrix;
-  pc.camPos = rs.camPos;
+  pc.globals = rs.globals;
   pc.skybox = skybox->bindPoint;
+  pc.intensity = intensity;
 
-  cmd.bindPipeline(pipeline);
-  cmd.pushConstants(pipeline, pc);
-  cmd.setViewport({0, 0, rs.colorBuffer->size.w, rs.colorBuffer->size.h});
-  cmd.bindMesh(cube);
-  cmdb.drawIndexed(cube->indicesCount, 1, 0, 0, 0);
-
-  cmd.endPass();
-}
\ No newline at end of file
+  // The camera comes from the global constants, the commands are only
+  // recorded again when the pipeline, the target or the intensity change
+  auto &activePipeline =
+      rs.colorBuffer->samples > 1 ? checkerboardPipeline : pipeline;
+  auto key = hash::fnv1a(activePipeline.getHandle());
+  key = hash::fnv1a(pc, key);
+  rs.passes->pass({rs.colorBuffer}, nullptr, false, rs.renderSize, skyboxPass,
+                  key,
+                  [this, &activePipeline, pc, renderSize = rs.renderSize](
+                      val::CommandBuffer &cmd, uint32_t) {
+                    cmd.bindPipeline(activePipeline);
+                    cmd.pushConstants(activePipeline, pc);
+                    cmd.setViewport({0, 0, renderSize.w, renderSize.h});
+                    cmd.bindMesh(cube);
+                    cmd.cmd.drawIndexed(cube->indicesCount, 1, 0, 0, 0);
+                  });
+}
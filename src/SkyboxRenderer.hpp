@@ -1,19 +1,55 @@
 #pragma once
 
+#include <vector>
+
+#include "ShaderLibrary.hpp"
 #include "types.hpp"
 
 class SkyboxRenderer {
 private:
   val::Engine &engine;
+  jobs::JobSystem &jobSystem;
+  ShaderLibrary &shaders;
+  val::TextureFormat colorFormat;
   val::GraphicsPipeline pipeline{};
+  val::GraphicsPipeline checkerboardPipeline{};
   val::Texture *skybox{};
   val::Mesh *cube;
+  val::ReusablePass skyboxPass;
+  uint64_t sourceHash = hash::FNV_OFFSET;
+  // Face decodes in flight, the images stay mapped until they finish
+  jobs::Counter faceLoads;
+  std::vector<file::ImageFile> faceImages;
+  uint64_t faceHashes[6]{};
+  bool facesLoaded = false;
+
+  void buildPipelines();
 
 public:
-  SkyboxRenderer(val::Engine &engine, val::BufferWriter &writer);
+  // Scales the sky radiance, EnvironmentMap::setSkyIntensity keeps the
+  // reflections in sync
+  float intensity = 1.f;
+
+  SkyboxRenderer(val::Engine &engine, jobs::JobSystem &jobSystem,
+                 val::BufferWriter &writer, ShaderLibrary &shaders,
+                 val::TextureFormat colorFormat = val::TextureFormat::RGBA16);
   ~SkyboxRenderer();
 
+  // Rebuilds the pipelines from the current shader binaries, call between
+  // frames
+  void reloadShaders();
+
+  // Queues the skybox pass on rs.passes
   void renderSkybox(RenderState &rs);
 
+  // The faces are decoded on worker threads while the constructor returns,
+  // waits for them. Call before the first BufferWriter::updateWrites
+  void finishLoading();
+
   val::Texture *getSkybox() { return skybox; }
+  // Hash of the face image files, identifies data baked from the skybox
+  uint64_t getSourceHash() {
+    finishLoading();
+    return sourceHash;
+  }
 };
\ No newline at end of file
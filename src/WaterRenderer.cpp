@@ -1,5 +1,7 @@
 #include "WaterRenderer.hpp"
 
+#include <cmath>
+
 constexpr size_t WATER_RESOLUTION = 2048;
 constexpr float WATER_PLANE_SIZE = 100;
 
@@ -9,14 +11,38 @@ constexpr size_t PATCHES_PER_GROUP = 256;
 constexpr size_t NUM_GROUPS = NUM_PATCHES / PATCHES_PER_GROUP;
 
 struct WaterPushConstants {
-  glm::mat4 projView;
-  glm::mat4 view;
-  glm::vec3 camPos;
-  val::BindPoint<val::Texture> skybox;
+  val::BindPoint<val::StorageBuffer> globals;
+  val::BindPoint<val::StorageBuffer> material;
+  val::BindPoint<val::Texture> ambient;
+  val::BindPoint<val::Texture> brdfLut;
+  float ambientMaxLod;
+};
+
+struct DeferredPushConstants {
+  glm::uvec2 renderSize;
+  val::BindPoint<val::StorageBuffer> globals;
+  val::BindPoint<val::Texture> ambient;
   val::BindPoint<val::StorageBuffer> material;
-  float time;
+  val::BindPoint<val::Texture> depth;
+  val::BindPoint<val::StorageImage> target;
+  val::BindPoint<val::Texture> brdfLut;
+  float ambientMaxLod;
 };
 
+constexpr uint32_t DEFERRED_TILE_SIZE = 8;
+// Size of the wave table of waterShade.comp, materials with more waves are
+// shaded forward instead of truncated
+constexpr uint32_t DEFERRED_MAX_WAVES = 128;
+
+// Wave counts without a preset are rounded up to a multiple of this, counts
+// above the largest bound use the unbounded generic variant
+constexpr uint32_t WAVE_COUNT_STEP = 16;
+constexpr uint32_t MAX_BOUNDED_WAVES = 128;
+// Exponents are specialized in steps of 1 / EXPONENT_STEPS
+constexpr float EXPONENT_STEPS = 2;
+// Further variants fall back to the generic one
+constexpr size_t MAX_WATER_VARIANTS = 12;
+
 struct DrawIndirectCommand {
   uint32_t vertexCount;
   uint32_t instanceCount;
@@ -30,55 +56,168 @@ struct ComputePushConstants {
   val::BindPoint<val::StorageBuffer> drawIndirectCommand;
 };
 
-WaterRenderer::WaterRenderer(val::Engine &engine,
-                             val::BufferWriter &bufferWritter)
-    : engine(engine), writer(bufferWritter) {
+WaterRenderer::WaterRenderer(val::Engine &engine, ShaderLibrary &shaders,
+                             val::TextureFormat colorFormat)
+    : engine(engine), shaders(shaders),
+      waterPatches(engine,
+                   [&](uint32_t) {
+                     return engine.createStorageBuffer(
+                         NUM_PATCHES * 4 * sizeof(glm::vec4),
+                         vk::BufferUsageFlagBits::eVertexBuffer);
+                   }),
+      drawIndirectCommand(engine,
+                          [&](uint32_t) {
+                            return engine.createStorageBuffer(
+                                sizeof(DrawIndirectCommand),
+                                vk::BufferUsageFlagBits::eIndirectBuffer);
+                          }),
+      materialBlock(engine), colorFormat(colorFormat), colorPass(engine),
+      depthPass(engine) {
+  loadShaders();
 
-  auto vertShader = file::readBinary("shaders/water.vert.spv");
-  auto fragShader = file::readBinary("shaders/water.frag.spv");
-  auto teseShader = file::readBinary("shaders/water.tese.spv");
-  auto tescShader = file::readBinary("shaders/water.tesc.spv");
+  variants.emplace_back(GENERIC_WATER_VARIANT,
+                        buildVariant(GENERIC_WATER_VARIANT));
+  for (auto &preset : WATER_PRESET_VARIANTS) {
+    variants.emplace_back(preset, buildVariant(preset));
+  }
 
-  val::PipelineBuilder builder(engine);
-  pipeline = builder.setPushConstant<WaterPushConstants>()
-                 .addVertexInputAttribute(0, val::VertexInputFormat::FLOAT4)
-                 .addColorAttachment(val::TextureFormat::RGBA16)
-                 .depthTestReadWrite()
-                 .addStage(std::span(vertShader), val::ShaderStage::VERTEX)
-                 .addStage(std::span(fragShader), val::ShaderStage::FRAGMENT)
-                 .addStage(std::span(teseShader),
-                           val::ShaderStage::TESSELATION_EVALUATION)
-                 .addStage(std::span(tescShader),
-                           val::ShaderStage::TESSELATION_CONTROL)
-                 .setTessellation(4)
-                 .tessellationFill()
-                 .setVertexStride(sizeof(glm::vec4))
-                 .build();
-
-  auto compShader = file::readBinary("shaders/water.comp.spv");
+  buildPatchGenerator();
+}
 
-  val::ComputePipelineBuilder cpBuild(engine);
+WaterRenderer::~WaterRenderer() {
+  for (auto buffer : waterPatches) {
+    engine.destroyStorageBuffer(buffer);
+  }
+  for (auto buffer : drawIndirectCommand) {
+    engine.destroyStorageBuffer(buffer);
+  }
+}
 
-  waterPatches =
-      engine.createStorageBuffer(NUM_PATCHES * 4 * sizeof(glm::vec4),
-                                 vk::BufferUsageFlagBits::eVertexBuffer);
+void WaterRenderer::loadShaders() {
+  vertShader = shaders.load("water.vert");
+  fragShader = shaders.load("water.frag");
+  teseShader = shaders.load("water.tese");
+  tescShader = shaders.load("water.tesc");
+  shadeShader = shaders.load("waterShade.comp");
+}
 
+void WaterRenderer::buildPatchGenerator() {
+  auto compShader = shaders.load("water.comp");
+  val::ComputePipelineBuilder cpBuild(engine);
   patchGenerator = cpBuild.setShader(compShader)
                        .setPushConstant<ComputePushConstants>()
                        .build();
+}
 
-  waterMaterial = engine.createStorageBuffer(sizeof(WaterMaterial));
-  drawIndirectCommand = engine.createStorageBuffer(
-      sizeof(DrawIndirectCommand), vk::BufferUsageFlagBits::eIndirectBuffer);
+void WaterRenderer::reloadShaders() {
+  colorPass.invalidate();
+  depthPass.invalidate();
+  loadShaders();
+  // Only the variants in use are rebuilt, the retired ones are destroyed
+  // once the frames in flight are done with them
+  for (auto &[variant, pipelines] : variants) {
+    for (size_t i = 0; i < 2; i++) {
+      engine.destroyPipeline(pipelines.pipeline[i]);
+      engine.destroyPipeline(pipelines.depthPipeline[i]);
+      engine.destroyPipeline(pipelines.equalPipeline[i]);
+    }
+    engine.destroyPipeline(pipelines.deferredShading);
+    pipelines = buildVariant(variant);
+  }
+
+  engine.destroyPipeline(patchGenerator);
+  buildPatchGenerator();
 }
 
-WaterRenderer::~WaterRenderer() {
-  engine.destroyStorageBuffer(waterPatches);
-  engine.destroyStorageBuffer(drawIndirectCommand);
+WaterPipelines WaterRenderer::buildVariant(const WaterVariant &variant) {
+  WaterPipelines pipelines;
+
+  val::PipelineBuilder builder(engine);
+  builder.setSpecializationConstant(0, variant.waveCount)
+      .setSpecializationConstant(1, VkBool32(variant.exactWaves))
+      .setSpecializationConstant(2, variant.exponent);
+  pipelines.pipeline[0] =
+      builder.setPushConstant<WaterPushConstants>()
+          .addVertexInputAttribute(0, val::VertexInputFormat::FLOAT4)
+          .addColorAttachment(colorFormat)
+          .depthTestReadWrite()
+          .addStage(std::span(vertShader), val::ShaderStage::VERTEX)
+          .addStage(std::span(fragShader), val::ShaderStage::FRAGMENT)
+          .addStage(std::span(teseShader),
+                    val::ShaderStage::TESSELATION_EVALUATION)
+          .addStage(std::span(tescShader), val::ShaderStage::TESSELATION_CONTROL)
+          .setTessellation(4)
+          .tessellationFill()
+          .setVertexStride(sizeof(glm::vec4))
+          .build();
+  pipelines.equalPipeline[0] = builder.depthTestEqual().build();
+  builder.setSampleShading(CHECKERBOARD_SAMPLES);
+  pipelines.equalPipeline[1] = builder.build();
+  pipelines.pipeline[1] = builder.depthTestReadWrite().build();
+
+  // water.tese declares gl_Position invariant so both passes produce the
+  // same depth
+  builder.clearColorAttachments()
+      .clearStages()
+      .addStage(std::span(vertShader), val::ShaderStage::VERTEX)
+      .addStage(std::span(teseShader), val::ShaderStage::TESSELATION_EVALUATION)
+      .addStage(std::span(tescShader), val::ShaderStage::TESSELATION_CONTROL);
+  pipelines.depthPipeline[1] = builder.build();
+  pipelines.depthPipeline[0] = builder.disableMultisampling().build();
+
+  val::ComputePipelineBuilder shadeBuild(engine);
+  pipelines.deferredShading =
+      shadeBuild.setShader(shadeShader)
+          .setPushConstant<DeferredPushConstants>()
+          .setSpecializationConstant(0, variant.waveCount)
+          .setSpecializationConstant(1, VkBool32(variant.exactWaves))
+          .setSpecializationConstant(2, variant.exponent)
+          .build();
+
+  return pipelines;
+}
+
+WaterPipelines &WaterRenderer::getPipelines(const WaterVariant &variant) {
+  for (auto &[key, pipelines] : variants) {
+    if (key == variant) {
+      return pipelines;
+    }
+  }
+  if (variants.size() >= MAX_WATER_VARIANTS) {
+    return variants.front().second;
+  }
+  return variants.emplace_back(variant, buildVariant(variant)).second;
+}
+
+WaterVariant WaterRenderer::selectVariant(const WaterMaterial &material) {
+  WaterVariant variant = GENERIC_WATER_VARIANT;
+
+  float exponent =
+      std::round(material.exponent * EXPONENT_STEPS) / EXPONENT_STEPS;
+  if (exponent == material.exponent && exponent > 0) {
+    variant.exponent = exponent;
+  }
+
+  for (auto &preset : WATER_PRESET_VARIANTS) {
+    if (preset.waveCount == material.numFreqs) {
+      variant.waveCount = preset.waveCount;
+      variant.exactWaves = true;
+      return variant;
+    }
+  }
+
+  if (material.numFreqs > MAX_BOUNDED_WAVES) {
+    return variant;
+  }
+  variant.waveCount = (material.numFreqs + WAVE_COUNT_STEP - 1) /
+                      WAVE_COUNT_STEP * WAVE_COUNT_STEP;
+  variant.exactWaves = variant.waveCount == material.numFreqs;
+  return variant;
 }
 
 void WaterRenderer::updateMaterial(const WaterMaterial &material) {
-  writer.enqueueBufferWrite(waterMaterial, &material, 0, sizeof(WaterMaterial));
+  materialBlock.set(material);
+  materialVariant = selectVariant(material);
 }
 
 void WaterRenderer::generatePatches(RenderState &rs) {
@@ -88,8 +227,9 @@ void WaterRenderer::generatePatches(RenderState &rs) {
 
   ComputePushConstants computePushConstants;
   computePushConstants.camPos = rs.camPos;
-  computePushConstants.drawIndirectCommand = drawIndirectCommand->bindPoint;
-  computePushConstants.waterPatches = waterPatches->bindPoint;
+  computePushConstants.drawIndirectCommand =
+      drawIndirectCommand.get()->bindPoint;
+  computePushConstants.waterPatches = waterPatches.get()->bindPoint;
 
   cmd.pushConstants(patchGenerator, computePushConstants);
 
@@ -99,24 +239,109 @@ void WaterRenderer::generatePatches(RenderState &rs) {
 }
 
 void WaterRenderer::renderWater(RenderState &rs) {
-  auto &cmd = *rs.cmd;
-  auto cmdb = cmd.cmd;
-
-  cmd.beginPass(std::span(&rs.colorBuffer, 1), rs.depthBuffer, true);
   WaterPushConstants pc;
-  pc.projView = rs.projectionMatrix * rs.viewMatrix;
-  pc.time = rs.time;
-  pc.camPos = rs.camPos;
-  pc.view = rs.viewMatrix;
-  pc.skybox = rs.ambientMap->bindPoint;
-  pc.material = waterMaterial->bindPoint;
-
-  cmd.bindPipeline(pipeline);
-  cmd.pushConstants(pipeline, pc);
-  cmd.setViewport({0, 0, rs.colorBuffer->size.w, rs.colorBuffer->size.h});
-  cmd.bindVertexBuffer(waterPatches);
-  cmdb.drawIndirect(drawIndirectCommand->buffer, 0, 1,
-                    sizeof(DrawIndirectCommand));
-
-  cmd.endPass();
+  pc.globals = rs.globals;
+  pc.material = materialBlock.update();
+  pc.ambient = rs.ambientMap->bindPoint;
+  pc.brdfLut = rs.brdfLut->bindPoint;
+  pc.ambientMaxLod = float(rs.ambientMap->mipLevels - 1);
+
+  auto &pipelines = getPipelines(materialVariant);
+
+  bool checkerboard = rs.colorBuffer->samples > 1;
+  if (deferred && !checkerboard && rs.colorBuffer->storage &&
+      materialBlock.get().numFreqs <= DEFERRED_MAX_WAVES) {
+    renderDeferred(rs, pipelines, pc);
+    return;
+  }
+
+  if (!depthPrepass) {
+    drawPatches(rs, {rs.colorBuffer}, true, pipelines.pipeline[checkerboard],
+                pc, colorPass);
+    return;
+  }
+
+  rs.passes->primary(
+      [](val::CommandBuffer &cmd) { cmd.beginProfile("water prepass"); });
+  drawPatches(rs, {}, true, pipelines.depthPipeline[checkerboard], pc,
+              depthPass);
+  rs.passes->primary([](val::CommandBuffer &cmd) {
+    cmd.endProfile();
+    cmd.memoryBarrier(vk::PipelineStageFlagBits2::eLateFragmentTests,
+                      vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+                      vk::PipelineStageFlagBits2::eEarlyFragmentTests,
+                      vk::AccessFlagBits2::eDepthStencilAttachmentRead);
+  });
+
+  drawPatches(rs, {rs.colorBuffer}, false,
+              pipelines.equalPipeline[checkerboard], pc, colorPass);
+}
+
+void WaterRenderer::renderDeferred(RenderState &rs, WaterPipelines &pipelines,
+                                   const WaterPushConstants &pc) {
+  drawPatches(rs, {}, true, pipelines.depthPipeline[0], pc, depthPass);
+
+  DeferredPushConstants dpc;
+  dpc.globals = pc.globals;
+  dpc.ambient = pc.ambient;
+  dpc.brdfLut = pc.brdfLut;
+  dpc.ambientMaxLod = pc.ambientMaxLod;
+  dpc.material = pc.material;
+  dpc.depth = rs.depthBuffer->bindPoint;
+  dpc.target = rs.colorBuffer->storageBindPoint;
+  dpc.renderSize = {rs.renderSize.w, rs.renderSize.h};
+
+  rs.passes->primary([&pipelines, dpc, colorBuffer = rs.colorBuffer,
+                      depthBuffer = rs.depthBuffer,
+                      renderSize = rs.renderSize](val::CommandBuffer &cmd) {
+    cmd.transitionTexture(depthBuffer, vk::ImageLayout::eDepthAttachmentOptimal,
+                          vk::PipelineStageFlagBits2::eLateFragmentTests,
+                          vk::ImageLayout::eShaderReadOnlyOptimal,
+                          vk::PipelineStageFlagBits2::eComputeShader);
+    // Keeps the skybox that is already in the colour buffer
+    cmd.transitionTexture(colorBuffer, vk::ImageLayout::eColorAttachmentOptimal,
+                          vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                          vk::ImageLayout::eGeneral,
+                          vk::PipelineStageFlagBits2::eComputeShader);
+
+    cmd.bindPipeline(pipelines.deferredShading);
+    cmd.pushConstants(pipelines.deferredShading, dpc);
+    cmd.cmd.dispatch(
+        (renderSize.w + DEFERRED_TILE_SIZE - 1) / DEFERRED_TILE_SIZE,
+        (renderSize.h + DEFERRED_TILE_SIZE - 1) / DEFERRED_TILE_SIZE, 1);
+
+    // Leave both as the forward path does
+    cmd.transitionTexture(colorBuffer, vk::ImageLayout::eGeneral,
+                          vk::PipelineStageFlagBits2::eComputeShader,
+                          vk::ImageLayout::eColorAttachmentOptimal,
+                          vk::PipelineStageFlagBits2::eAllCommands);
+    cmd.transitionTexture(depthBuffer, vk::ImageLayout::eShaderReadOnlyOptimal,
+                          vk::PipelineStageFlagBits2::eComputeShader,
+                          vk::ImageLayout::eDepthAttachmentOptimal,
+                          vk::PipelineStageFlagBits2::eAllCommands);
+  });
+}
+
+void WaterRenderer::drawPatches(RenderState &rs,
+                                std::vector<val::Texture *> framebuffers,
+                                bool clearDepth,
+                                val::GraphicsPipeline &pipeline,
+                                const WaterPushConstants &pc,
+                                val::ReusablePass &pass) {
+  // The camera and time come from the global constants and the patches from
+  // the copies of the slot, the commands are only recorded again when the
+  // pipeline, the target or the bind points change
+  auto key = hash::fnv1a(pipeline.getHandle());
+  key = hash::fnv1a(pc, key);
+  rs.passes->pass(std::move(framebuffers), rs.depthBuffer, clearDepth,
+                  rs.renderSize, pass, key,
+                  [this, &pipeline, pc, renderSize = rs.renderSize](
+                      val::CommandBuffer &cmd, uint32_t slot) {
+                    cmd.bindPipeline(pipeline);
+                    cmd.pushConstants(pipeline, pc);
+                    cmd.setViewport({0, 0, renderSize.w, renderSize.h});
+                    cmd.bindVertexBuffer(waterPatches[slot]);
+                    cmd.cmd.drawIndirect(drawIndirectCommand[slot]->buffer, 0,
+                                         1, sizeof(DrawIndirectCommand));
+                  });
 }
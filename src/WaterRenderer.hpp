@@ -1,7 +1,14 @@
 #pragma once
 
+#include "ShaderLibrary.hpp"
 #include "types.hpp"
 
+// Wave counts and exponent of the presets, WaterRenderer keeps pipelines
+// specialized for them
+constexpr uint32_t OPEN_SEA_WAVES = 65;
+constexpr uint32_t CALM_LAKE_WAVES = 12;
+constexpr float DEFAULT_WAVE_EXPONENT = 7;
+
 struct WaterMaterial {
   glm::vec4 diffuseColor = {0.f, 0.2f, 0.25f, 1.f};
   glm::vec2 baseD = {1, 0};
@@ -17,25 +24,136 @@ struct WaterMaterial {
   float baseReflectivity = 0.02;
 
   float roughness = 0.12;
+
+  // Sharpness of the wave crests
+  float exponent = DEFAULT_WAVE_EXPONENT;
+};
+
+inline WaterMaterial openSeaMaterial() {
+  WaterMaterial material;
+  material.numFreqs = OPEN_SEA_WAVES;
+  material.baseA = 0.6;
+  material.baseW = 0.2;
+  material.aMult = 0.8;
+  material.wMult = 1.2;
+  material.diffuseColor = glm::vec4(0.f, 18.f / 255, 55.f / 255, 0.f);
+  material.baseReflectivity = 0.015;
+  material.roughness = 0.152;
+  material.speed = 2;
+  return material;
+}
+
+inline WaterMaterial calmLakeMaterial() {
+  WaterMaterial material;
+  material.numFreqs = CALM_LAKE_WAVES;
+  material.baseA = 0.06;
+  material.baseW = 0.5;
+  material.aMult = 0.8;
+  material.wMult = 1.2;
+  material.diffuseColor = glm::vec4(0.f, 54.f / 255, 89.f / 255, 0.f);
+  material.baseReflectivity = 0.02;
+  material.roughness = 0.06;
+  material.speed = 0.9;
+  return material;
+}
+
+// Specialization constants of the wave evaluation, see water.h
+struct WaterVariant {
+  // 0 leaves the wave loops unbounded
+  uint32_t waveCount;
+  // The material has exactly waveCount waves, otherwise it is an upper bound
+  bool exactWaves;
+  // 0 reads the exponent from the material
+  float exponent;
+
+  bool operator==(const WaterVariant &) const = default;
+};
+
+// Handles any material, however many waves it has
+constexpr WaterVariant GENERIC_WATER_VARIANT = {0, false, 0};
+constexpr WaterVariant WATER_PRESET_VARIANTS[] = {
+    {OPEN_SEA_WAVES, true, DEFAULT_WAVE_EXPONENT},
+    {CALM_LAKE_WAVES, true, DEFAULT_WAVE_EXPONENT}};
+
+struct WaterPipelines {
+  // Indexed by whether the target is a checkerboard target, those need the
+  // per sample shaded variant
+  val::GraphicsPipeline pipeline[2];
+  // Depth only pass and the colour pass that shades its visible pixels
+  val::GraphicsPipeline depthPipeline[2];
+  val::GraphicsPipeline equalPipeline[2];
+  val::ComputePipeline deferredShading;
 };
 
+struct WaterPushConstants;
+
 class WaterRenderer {
 private:
   val::Engine &engine;
-  val::BufferWriter &writer;
-  val::StorageBuffer *waterPatches;
-  val::StorageBuffer *drawIndirectCommand;
-  val::StorageBuffer *waterMaterial;
-  val::GraphicsPipeline pipeline;
+  ShaderLibrary &shaders;
+  // Written by the patch generator every frame, one copy per frame in
+  // flight so a frame never overwrites the patches the previous one draws
+  val::PerFrame<val::StorageBuffer *> waterPatches;
+  val::PerFrame<val::StorageBuffer *> drawIndirectCommand;
+  val::ParamBlock<WaterMaterial> materialBlock;
   val::ComputePipeline patchGenerator;
 
+  val::TextureFormat colorFormat;
+  // Recorded once per pipeline and target, the depth pass is shared by the
+  // prepass and the deferred path
+  val::ReusablePass colorPass, depthPass;
+  // Owned by the shader library, refreshed by reloadShaders
+  std::span<const uint8_t> vertShader, fragShader, teseShader, tescShader,
+      shadeShader;
+  // Built on first use, the generic variant is always the first one
+  std::vector<std::pair<WaterVariant, WaterPipelines>> variants;
+  WaterVariant materialVariant = GENERIC_WATER_VARIANT;
+
+  void loadShaders();
+  void buildPatchGenerator();
+  WaterPipelines buildVariant(const WaterVariant &variant);
+  WaterPipelines &getPipelines(const WaterVariant &variant);
+
+  void renderDeferred(RenderState &rs, WaterPipelines &pipelines,
+                      const WaterPushConstants &pc);
+  // Queues a pass drawing the patches into framebuffers and the depth buffer
+  void drawPatches(RenderState &rs, std::vector<val::Texture *> framebuffers,
+                   bool clearDepth, val::GraphicsPipeline &pipeline,
+                   const WaterPushConstants &pc, val::ReusablePass &pass);
+
 public:
-  WaterRenderer(val::Engine &engine, val::BufferWriter &bufferWritter);
+  // Lay down depth first so the fragment shader runs once per visible pixel,
+  // at the cost of tessellating the surface twice
+  bool depthPrepass = false;
+  // Rasterize depth only and shade in a compute pass, needs a single sampled
+  // colour buffer with storage usage and at most 128 waves, otherwise the
+  // forward path is used
+  bool deferred = false;
+
+  WaterRenderer(val::Engine &engine, ShaderLibrary &shaders,
+                val::TextureFormat colorFormat = val::TextureFormat::RGBA16);
   ~WaterRenderer();
 
+  // Rebuilds every pipeline from the current shader binaries, call between
+  // frames
+  void reloadShaders();
+
+  // Also selects the pipeline variant the next draws use. Only the bytes
+  // that changed are written, when the frame is rendered
   void updateMaterial(const WaterMaterial &material);
 
+  // Variant for the material, wave counts are rounded up to a few buckets
+  // and exponents off a half step grid are read at runtime
+  static WaterVariant selectVariant(const WaterMaterial &material);
+
   void generatePatches(RenderState &rs);
 
+  // Queues the water passes on rs.passes
   void renderWater(RenderState &rs);
+
+  // Bind point of the material in the frame being recorded, valid after
+  // renderWater
+  val::BindPoint<val::StorageBuffer> getMaterial() const {
+    return materialBlock.getBindPoint();
+  }
 };
\ No newline at end of file
@@ -2,38 +2,244 @@
 
 #include <stb_image.h>
 
+#include <algorithm>
+#include <cassert>
 #include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "hash.hpp"
 
 namespace file {
-std::vector<uint8_t> readBinary(const std::string& path) {
-    std::ifstream file(std::string(RESPATH) + path,
-                       std::ios::ate | std::ios::binary);
+static MappedFile mountedPack;
+static std::span<const pack::Entry> packIndex;
 
-    if (!file.is_open()) {
+bool mountPack(const std::string& path) {
+    if (!exists(path)) {
+        return false;
+    }
+    MappedFile pack(path);
+    auto data = pack.data();
+
+    pack::Header header;
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    size_t indexEnd =
+        sizeof(header) + size_t(header.entryCount) * sizeof(pack::Entry);
+    if (header.magic != pack::MAGIC || header.version != pack::VERSION ||
+        data.size() < indexEnd) {
+        return false;
+    }
+
+    // The header keeps the index aligned
+    auto entries = (const pack::Entry*)(data.data() + sizeof(header));
+    for (uint32_t i = 0; i < header.entryCount; i++) {
+        if (entries[i].offset + entries[i].size > data.size()) {
+            return false;
+        }
+    }
+
+    mountedPack = std::move(pack);
+    packIndex = {entries, header.entryCount};
+    return true;
+}
+
+const pack::Entry* findPacked(const std::string& path) {
+    auto entry = std::lower_bound(
+        packIndex.begin(), packIndex.end(), path,
+        [](const pack::Entry& e, const std::string& p) { return e.name < p; });
+    if (entry == packIndex.end() || entry->name != path) {
+        return nullptr;
+    }
+    return &*entry;
+}
+
+MappedFile::MappedFile(const std::string& path) {
+    if (auto entry = findPacked(path);
+        entry && entry->type == pack::EntryType::RAW) {
+        bytes = mountedPack.data().data() + entry->offset;
+        length = entry->size;
+        return;
+    }
+
+    owned = true;
+    std::string fullPath = std::string(RESPATH) + path;
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(fullPath.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                                nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
         throw std::runtime_error("Cannot read file: " + path);
     }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(handle, &fileSize);
+    length = (size_t)fileSize.QuadPart;
+    // Empty files cannot be mapped, they are an empty span
+    if (length > 0) {
+        mapping =
+            CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            bytes = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0,
+                                                  0, 0);
+        }
+    }
+    CloseHandle(handle);
+#else
+    int fd = open(fullPath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot read file: " + path);
+    }
+    struct stat info;
+    fstat(fd, &info);
+    length = (size_t)info.st_size;
+    if (length > 0) {
+        void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view != MAP_FAILED) {
+            bytes = (const uint8_t*)view;
+            // Assets are read front to back once
+            madvise(view, length, MADV_SEQUENTIAL);
+        }
+    }
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+#endif
+    if (length > 0 && !bytes) {
+        close();
+        throw std::runtime_error("Cannot map file: " + path);
+    }
+}
 
-    size_t fileSize = (size_t)file.tellg();
+MappedFile::~MappedFile() { close(); }
 
-    std::vector<uint8_t> buffer(fileSize);
+MappedFile::MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
 
-    file.seekg(0);
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        bytes = std::exchange(other.bytes, nullptr);
+        length = std::exchange(other.length, 0);
+        owned = std::exchange(other.owned, false);
+#ifdef _WIN32
+        mapping = std::exchange(other.mapping, nullptr);
+#endif
+    }
+    return *this;
+}
 
-    file.read((char*)buffer.data(), fileSize);
-    return buffer;
+void MappedFile::close() {
+    if (!owned) {
+        bytes = nullptr;
+        length = 0;
+        return;
+    }
+#ifdef _WIN32
+    if (bytes) {
+        UnmapViewOfFile(bytes);
+    }
+    if (mapping) {
+        CloseHandle(mapping);
+    }
+    mapping = nullptr;
+#else
+    if (bytes) {
+        munmap((void*)bytes, length);
+    }
+#endif
+    bytes = nullptr;
+    length = 0;
+    owned = false;
 }
 
-ImageData loadImage(const std::string& path) {
+ImageFile::ImageFile(const std::string& path) {
+    packed = findPacked(path);
+    if (packed && packed->type == pack::EntryType::IMAGE_RGBA8) {
+        size = {packed->width, packed->height};
+        return;
+    }
+    packed = nullptr;
+
+    file = MappedFile(path);
+    int w = 0, h = 0, channels;
+    if (!stbi_info_from_memory(file.data().data(), (int)file.size(), &w, &h,
+                               &channels)) {
+        throw std::runtime_error("Cannot read image: " + path);
+    }
+    size.w = w;
+    size.h = h;
+}
+
+uint64_t ImageFile::hash() const {
+    if (packed) {
+        return packed->hash;
+    }
+    return hash::fnv1a(file.data().data(), file.size());
+}
+
+bool ImageFile::decode(std::span<uint8_t> dst) const {
+    assert(dst.size() >= decodedSize());
+    if (packed) {
+        memcpy(dst.data(), mountedPack.data().data() + packed->offset,
+               decodedSize());
+        return true;
+    }
     int w, h, channels;
-    std::string fullPath = std::string(RESPATH) + path;
-    uint8_t* img = stbi_load(fullPath.c_str(), &w, &h, &channels, 4);
-    ImageData ret;
-    ret.size.w = w;
-    ret.size.h = h;
-    ret.data.resize(w * h * 4);
-    memcpy(ret.data.data(), img, w * h * 4);
+    // stb always decodes into its own allocation, this is the only copy
+    // between the mapped file and dst
+    uint8_t* img = stbi_load_from_memory(file.data().data(), (int)file.size(),
+                                         &w, &h, &channels, 4);
+    if (!img) {
+        return false;
+    }
+    memcpy(dst.data(), img, decodedSize());
     stbi_image_free(img);
+    return true;
+}
+
+std::vector<uint8_t> readBinary(const std::string& path) {
+    MappedFile file(path);
+    return {file.data().begin(), file.data().end()};
+}
+
+bool writeBinary(const std::string& path, std::span<const uint8_t> data) {
+    std::filesystem::path fullPath(std::string(RESPATH) + path);
+    std::error_code error;
+    std::filesystem::create_directories(fullPath.parent_path(), error);
+
+    std::ofstream file(fullPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file.write((const char*)data.data(), data.size());
+    return file.good();
+}
+
+bool exists(const std::string& path) {
+    std::error_code error;
+    return std::filesystem::exists(std::string(RESPATH) + path, error);
+}
+
+ImageData loadImage(const std::string& path) {
+    ImageFile image(path);
+    ImageData ret;
+    ret.size = image.size;
+    ret.data.resize(image.decodedSize());
+    image.decode(ret.data);
     return ret;
 }
 }  // namespace file
@@ -1,12 +1,78 @@
 #pragma once
 
 #include <cstdint>
+#include <span>
 #include <string>
 #include <vector>
 
+#include "pack.hpp"
 #include "types.hpp"
 
 namespace file {
+// Maps an asset pack relative to res/, files in it are then served from the
+// pack and everything else from the loose files. Returns false when the
+// pack is missing or from another version
+bool mountPack(const std::string& path);
+// Entry of a path in the mounted pack, null when it is not packed
+const pack::Entry* findPacked(const std::string& path);
+
+// Read only view of a whole file through the page cache, no copy is made.
+// Raw entries of the mounted pack are views into it. The span stays valid
+// for the lifetime of the object
+class MappedFile {
+   public:
+    MappedFile() = default;
+    // Throws when the file cannot be opened
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::span<const uint8_t> data() const { return {bytes, length}; }
+    size_t size() const { return length; }
+
+   private:
+    const uint8_t* bytes{};
+    size_t length{};
+    // False for views into the mounted pack
+    bool owned{};
+#ifdef _WIN32
+    void* mapping{};
+#endif
+
+    void close();
+};
+
+// An encoded image kept mapped, decoding writes straight into the caller's
+// memory, e.g. a staging buffer. Packed images are stored decoded and are
+// only copied
+class ImageFile {
+   public:
+    explicit ImageFile(const std::string& path);
+
+    // Size of the decoded image, read from the header only
+    Size size;
+    // Bytes of the RGBA8 pixels decode writes
+    size_t decodedSize() const { return size_t(size.w) * size.h * 4; }
+    // FNV-1a of the encoded file, stored in the pack for packed images
+    uint64_t hash() const;
+
+    // dst must hold decodedSize() bytes, returns false when the image cannot
+    // be decoded
+    bool decode(std::span<uint8_t> dst) const;
+
+   private:
+    MappedFile file;
+    const pack::Entry* packed{};
+};
+
 std::vector<uint8_t> readBinary(const std::string& path);
+// Creates the missing parent directories, returns false when the file cannot
+// be written
+bool writeBinary(const std::string& path, std::span<const uint8_t> data);
+bool exists(const std::string& path);
 ImageData loadImage(const std::string& path);
 };  // namespace file
@@ -1,4 +1,7 @@
 #pragma once
 #include "file.hpp"
+#include "hash.hpp"
+#include "jobs.hpp"
 #include "memory.hpp"
+#include "pack.hpp"
 #include "types.hpp"
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace hash {
+constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+// 64 bit FNV-1a, pass the previous result as seed to hash several blocks
+inline uint64_t fnv1a(const void* data, size_t size,
+                      uint64_t seed = FNV_OFFSET) {
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        seed ^= bytes[i];
+        seed *= FNV_PRIME;
+    }
+    return seed;
+}
+
+// Hashes the bytes of a value, pointers go through the overload above
+template <typename T>
+    requires(!std::is_pointer_v<T>)
+inline uint64_t fnv1a(const T& value, uint64_t seed = FNV_OFFSET) {
+    return fnv1a(&value, sizeof(T), seed);
+}
+}  // namespace hash
@@ -0,0 +1,200 @@
+#include "jobs.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace jobs {
+static thread_local const JobSystem* workerSystem = nullptr;
+static thread_local int workerIndex = -1;
+
+JobSystem::JobSystem(uint32_t workerCount) {
+    if (workerCount == 0) {
+        // hardware_concurrency may be unknown and return 0
+        workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+    for (uint32_t i = 0; i < workerCount; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    // Started once every deque exists, workers steal from all of them
+    for (uint32_t i = 0; i < workerCount; i++) {
+        workers[i]->thread = std::thread([this, i] { workerLoop(i); });
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    // Workers drain the queued jobs before they exit
+    for (auto& worker : workers) {
+        worker->thread.join();
+    }
+}
+
+int JobSystem::getCurrentWorker() const {
+    return workerSystem == this ? workerIndex : -1;
+}
+
+void JobSystem::run(std::function<void()> function, Counter* counter) {
+    if (counter) {
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    push({std::move(function), counter});
+}
+
+void JobSystem::runAfter(Counter& dependency, std::function<void()> function,
+                         Counter* counter) {
+    if (counter) {
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    Job job{std::move(function), counter};
+    {
+        // finish drains the continuations under the same lock, so the job
+        // is either queued here or picked up there
+        std::lock_guard lock(dependency.mutex);
+        if (!dependency.done()) {
+            dependency.continuations.push_back(std::move(job));
+            return;
+        }
+    }
+    push(std::move(job));
+}
+
+void JobSystem::parallelFor(size_t count, size_t grain,
+                            std::function<void(size_t, size_t)> function,
+                            Counter* counter) {
+    grain = std::max<size_t>(grain, 1);
+    // Shared by the chunks instead of copied into each
+    auto shared =
+        std::make_shared<std::function<void(size_t, size_t)>>(std::move(function));
+    for (size_t begin = 0; begin < count; begin += grain) {
+        size_t end = std::min(begin + grain, count);
+        run([shared, begin, end] { (*shared)(begin, end); }, counter);
+    }
+}
+
+void JobSystem::wait(Counter& counter) {
+    int worker = getCurrentWorker();
+    while (!counter.done()) {
+        if (!tryRun(worker)) {
+            std::this_thread::yield();
+        }
+    }
+    // The job that finished the counter may still hold its lock
+    std::lock_guard lock(counter.mutex);
+}
+
+std::vector<WorkerStats> JobSystem::getWorkerStats() const {
+    std::vector<WorkerStats> stats;
+    for (auto& worker : workers) {
+        stats.push_back({worker->jobsRun.load(std::memory_order_relaxed),
+                         worker->busyNs.load(std::memory_order_relaxed)});
+    }
+    return stats;
+}
+
+void JobSystem::push(Job job) {
+    // Workers keep what they spawn, everyone else spreads jobs round robin
+    int worker = getCurrentWorker();
+    if (worker < 0) {
+        worker = nextWorker.fetch_add(1, std::memory_order_relaxed) %
+                 workers.size();
+    }
+    {
+        std::lock_guard lock(workers[worker]->mutex);
+        workers[worker]->jobs.push_back(std::move(job));
+    }
+    queued.fetch_add(1, std::memory_order_release);
+
+    // Taking the lock orders this with the sleeping worker's check of queued
+    { std::lock_guard lock(sleepMutex); }
+    wake.notify_one();
+}
+
+bool JobSystem::tryRun(int worker) {
+    Job job;
+    bool found = false;
+    if (worker >= 0) {
+        auto& own = *workers[worker];
+        std::lock_guard lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            found = true;
+        }
+    }
+    // Steal the oldest job, starting after our own deque so thieves spread
+    size_t first = worker + 1;
+    for (size_t i = 0; !found && i < workers.size(); i++) {
+        size_t victimIndex = (first + i) % workers.size();
+        if ((int)victimIndex == worker) {
+            continue;
+        }
+        auto& victim = *workers[victimIndex];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            found = true;
+        }
+    }
+    if (!found) {
+        return false;
+    }
+
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    execute(job, worker);
+    return true;
+}
+
+void JobSystem::execute(Job& job, int worker) {
+    auto start = std::chrono::steady_clock::now();
+    job.function();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    if (worker >= 0) {
+        auto& stats = *workers[worker];
+        stats.jobsRun.fetch_add(1, std::memory_order_relaxed);
+        stats.busyNs.fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                .count(),
+            std::memory_order_relaxed);
+    }
+    finish(job.counter);
+}
+
+void JobSystem::finish(Counter* counter) {
+    if (!counter) {
+        return;
+    }
+    std::vector<Job> ready;
+    {
+        std::lock_guard lock(counter->mutex);
+        if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            ready.swap(counter->continuations);
+        }
+    }
+    for (auto& job : ready) {
+        push(std::move(job));
+    }
+}
+
+void JobSystem::workerLoop(uint32_t index) {
+    workerSystem = this;
+    workerIndex = (int)index;
+    while (true) {
+        if (tryRun((int)index)) {
+            continue;
+        }
+        std::unique_lock lock(sleepMutex);
+        wake.wait(lock, [this] {
+            return stopping || queued.load(std::memory_order_acquire) > 0;
+        });
+        if (stopping && queued.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
+}  // namespace jobs
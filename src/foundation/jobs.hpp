@@ -0,0 +1,103 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace jobs {
+class Counter;
+
+struct Job {
+    std::function<void()> function;
+    // Decremented once the function returns
+    Counter* counter{};
+};
+
+// Number of unfinished jobs of a group. Threads wait for it through
+// JobSystem::wait, jobs through JobSystem::runAfter. Only destroy it after a
+// wait, a finishing job may still be touching it otherwise
+class Counter {
+    friend class JobSystem;
+
+   public:
+    Counter() = default;
+    ~Counter() { std::lock_guard lock(mutex); }
+    Counter(const Counter&) = delete;
+    Counter& operator=(const Counter&) = delete;
+
+    bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+   private:
+    std::atomic<uint32_t> pending{0};
+    std::mutex mutex;
+    // Started when pending reaches zero
+    std::vector<Job> continuations;
+};
+
+// Cumulative since the pool started, diff two samples for the utilization
+// over an interval
+struct WorkerStats {
+    uint64_t jobs{};
+    uint64_t busyNs{};
+};
+
+// Work stealing pool. Each worker runs the newest job of its own deque and
+// steals the oldest from the others when it runs dry, threads that wait on a
+// counter run jobs too
+class JobSystem {
+   public:
+    // 0 sizes the pool from the hardware, leaving a core to the thread that
+    // submits and waits
+    explicit JobSystem(uint32_t workerCount = 0);
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void run(std::function<void()> function, Counter* counter = nullptr);
+    // Starts the job once dependency reaches zero, counter counts it from now
+    void runAfter(Counter& dependency, std::function<void()> function,
+                  Counter* counter = nullptr);
+    // Calls function(begin, end) over [0, count) in chunks of at most grain
+    // elements, each chunk is a job
+    void parallelFor(size_t count, size_t grain,
+                     std::function<void(size_t, size_t)> function,
+                     Counter* counter = nullptr);
+    // Runs queued jobs on the calling thread until the counter reaches zero
+    void wait(Counter& counter);
+
+    uint32_t getWorkerCount() const { return (uint32_t)workers.size(); }
+    // Index of the calling thread in the pool, -1 for threads outside it.
+    // Lets jobs pick per thread resources
+    int getCurrentWorker() const;
+    std::vector<WorkerStats> getWorkerStats() const;
+
+   private:
+    struct Worker {
+        std::thread thread;
+        std::mutex mutex;
+        std::deque<Job> jobs;
+        std::atomic<uint64_t> jobsRun{0};
+        std::atomic<uint64_t> busyNs{0};
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    // Jobs in the deques, the workers sleep while it is zero
+    std::atomic<size_t> queued{0};
+    std::atomic<uint32_t> nextWorker{0};
+    bool stopping = false;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+
+    void push(Job job);
+    bool tryRun(int worker);
+    void execute(Job& job, int worker);
+    void finish(Counter* counter);
+    void workerLoop(uint32_t index);
+};
+}  // namespace jobs
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Layout of res/assets.pack, written by tools/packer.cpp. A header, the
+// index sorted by name, then the payloads, each aligned to ALIGNMENT
+namespace pack {
+constexpr uint32_t MAGIC = 0x4b415056;  // "VPAK"
+// Bump when the layout changes, older packs are ignored
+constexpr uint32_t VERSION = 1;
+constexpr size_t NAME_SIZE = 64;
+constexpr size_t ALIGNMENT = 16;
+
+enum class EntryType : uint32_t {
+    // The file as is
+    RAW,
+    // An image decoded to tightly packed RGBA8 pixels
+    IMAGE_RGBA8
+};
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t padding;
+};
+
+struct Entry {
+    // Path relative to res/, NUL terminated
+    char name[NAME_SIZE];
+    uint64_t offset;
+    uint64_t size;
+    // FNV-1a of the source file, the same as hashing the loose file
+    uint64_t hash;
+    EntryType type;
+    // Size of decoded images
+    uint32_t width;
+    uint32_t height;
+    uint32_t padding;
+};
+}  // namespace pack
@@ -7,12 +7,23 @@
 #include <SDL3/SDL_vulkan.h>
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/matrix.hpp>
 
+#include "Benchmark.hpp"
+#include "Checkerboard.hpp"
+#include "DynamicResolution.hpp"
+#include "EnvironmentMap.hpp"
+#include "FrameGlobals.hpp"
 #include "PostProcess.hpp"
+#include "ShaderLibrary.hpp"
 #include "SkyboxRenderer.hpp"
 #include "WaterRenderer.hpp"
 
@@ -150,32 +161,314 @@ public:
   glm::vec2 getMouseDelta() { return mouseDelta; }
 };
 
-int main()
+struct Options
 {
-  Size winsize = {1920, 1080};
-  auto win = std::make_unique<Window>(winsize, "My vulkan app!!");
-  InputManager input(win.get());
+  // Render without a window into the engine's own image ring
+  bool headless = false;
+  // Number of frames to render before exiting, 0 runs until the window closes
+  uint32_t frames = 0;
+  // Benchmark script to play instead of user input, relative to res/
+  std::string benchmark;
+  std::string report = "benchmark.json";
+  // Baseline to compare the benchmark against, the process fails when a
+  // metric regresses by more than the tolerance percentage
+  std::string baseline;
+  std::string writeBaseline;
+  double tolerance = 10;
+  // Directory with a reference per device, see Benchmark::checkReference
+  std::string referenceDir;
+  Size resolution = {1920, 1080};
+  // Enables dynamic resolution with this GPU frame time target
+  float targetGpuMs = 0;
+  Upscaler upscaler = Upscaler::Bilinear;
+  // Shade half of the pixels each frame and reconstruct the rest
+  bool checkerboard = false;
+  bool graphicsPostProcess = false;
+  // Post process straight into the swapchain image, saving the blit from
+  // the output image. Swapchain images have no storage usage, so this uses
+  // the graphics tonemap instead of the compute one
+  bool renderToSwapchain = false;
+  // Format of the HDR scene colour buffer
+  val::TextureFormat sceneFormat = val::TextureFormat::RGBA16;
+  bool depthPrepass = false;
+  bool deferredWater = false;
+  bool halfResFog = false;
+  float skyIntensity = 1;
+  // Recompile shaders from res/shaderSources when they change
+  bool hotReload = false;
+  // Ignore res/assets.pack, e.g. while editing textures
+  bool looseAssets = false;
+  // Binary PPM of the last frame, headless only
+  std::string screenshot;
+};
+
+Options parseOptions(int argc, char **argv)
+{
+  Options options;
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "--headless")
+      options.headless = true;
+    else if (arg == "--frames" && i + 1 < argc)
+      options.frames = std::stoul(argv[++i]);
+    else if (arg == "--benchmark" && i + 1 < argc)
+      options.benchmark = argv[++i];
+    else if (arg == "--report" && i + 1 < argc)
+      options.report = argv[++i];
+    else if (arg == "--baseline" && i + 1 < argc)
+      options.baseline = argv[++i];
+    else if (arg == "--write-baseline" && i + 1 < argc)
+      options.writeBaseline = argv[++i];
+    else if (arg == "--tolerance" && i + 1 < argc)
+      options.tolerance = std::stod(argv[++i]);
+    else if (arg == "--reference-dir" && i + 1 < argc)
+      options.referenceDir = argv[++i];
+    else if (arg == "--target-gpu-ms" && i + 1 < argc)
+      options.targetGpuMs = std::stof(argv[++i]);
+    else if (arg == "--upscaler" && i + 1 < argc)
+      options.upscaler = std::string(argv[++i]) == "edge"
+                             ? Upscaler::EdgeAdaptive
+                             : Upscaler::Bilinear;
+    else if (arg == "--checkerboard")
+      options.checkerboard = true;
+    else if (arg == "--graphics-postprocess")
+      options.graphicsPostProcess = true;
+    else if (arg == "--half-res-fog")
+      options.halfResFog = true;
+    else if (arg == "--render-to-swapchain")
+      options.renderToSwapchain = true;
+    else if (arg == "--depth-prepass")
+      options.depthPrepass = true;
+    else if (arg == "--deferred-water")
+      options.deferredWater = true;
+    else if (arg == "--sky-intensity" && i + 1 < argc)
+      options.skyIntensity = std::stof(argv[++i]);
+    else if (arg == "--hot-reload")
+      options.hotReload = true;
+    else if (arg == "--loose-assets")
+      options.looseAssets = true;
+    else if (arg == "--screenshot" && i + 1 < argc)
+      options.screenshot = argv[++i];
+    else if (arg == "--packed-hdr")
+      options.sceneFormat = val::TextureFormat::B10G11R11;
+    else if (arg == "--resolution" && i + 1 < argc)
+      sscanf(argv[++i], "%ux%u", &options.resolution.w, &options.resolution.h);
+  }
+
+  // There is no window to close in headless mode
+  if (options.headless && options.frames == 0)
+    options.frames = 600;
+
+  return options;
+}
+
+// Headless frames are BGRA8, PPM stores RGB
+bool writeScreenshot(const std::string &path, Size size,
+                     const std::vector<uint8_t> &pixels)
+{
+  std::ofstream out(path, std::ios::binary);
+  if (!out.is_open())
+    return false;
+
+  out << "P6\n" << size.w << " " << size.h << "\n255\n";
+  std::vector<uint8_t> rgb(size_t(size.w) * size.h * 3);
+  for (size_t i = 0; i < rgb.size() / 3; i++)
+  {
+    rgb[i * 3 + 0] = pixels[i * 4 + 2];
+    rgb[i * 3 + 1] = pixels[i * 4 + 1];
+    rgb[i * 3 + 2] = pixels[i * 4 + 0];
+  }
+  out.write((const char *)rgb.data(), rgb.size());
+  return out.good();
+}
+
+void drawUi(WaterMaterial &material, WaterRenderer &waterRenderer,
+            DynamicResolution &dynamicResolution, PostProcess &postProcess,
+            Checkerboard &checkerboard, SkyboxRenderer &skyboxRenderer,
+            val::GpuScheduler &scheduler, float delta)
+{
+  bool isTrue = true;
+
+  ImGui_ImplVulkan_NewFrame();
+  ImGui_ImplSDL3_NewFrame();
+  ImGui::NewFrame();
+  ImGui::Begin("vkRaster", &isTrue);
+
+  ImGui::Text("FPS: %d", (uint32_t)(1 / std::max(delta, 0.0001f)));
+
+  if (ImGui::Button("Open sea"))
+    material = openSeaMaterial();
+
+  if (ImGui::Button("Calm lake"))
+    material = calmLakeMaterial();
+
+  // Draw material params
+
+  ImGui::SliderInt("Number of waves", (int *)&material.numFreqs, 1, 128);
+
+  ImGui::SliderFloat("A", &material.baseA, 0, 1);
+  ImGui::InputFloat("W", &material.baseW);
+
+  ImGui::InputFloat("A Mult", &material.aMult);
+  ImGui::InputFloat("W Mult", &material.wMult);
+
+  ImGui::ColorPicker3("Diffuse color", glm::value_ptr(material.diffuseColor));
+
+  ImGui::InputFloat("F0", &material.baseReflectivity);
+
+  ImGui::SliderFloat("Roughness", &material.roughness, 0, 1);
+
+  ImGui::InputFloat("Speed", &material.speed);
+
+  // Half steps keep the exponent on the specialized pipeline variants
+  if (ImGui::SliderFloat("Wave exponent", &material.exponent, 1, 16, "%.1f"))
+    material.exponent = std::round(material.exponent * 2) / 2;
+
+  ImGui::Checkbox("Water depth pre-pass", &waterRenderer.depthPrepass);
+  ImGui::Checkbox("Deferred water shading", &waterRenderer.deferred);
+
+  ImGui::Checkbox("Dynamic resolution", &dynamicResolution.enabled);
+  ImGui::SliderFloat("Target GPU ms", &dynamicResolution.targetMs, 2, 33);
+  auto renderSize = dynamicResolution.getRenderSize();
+  ImGui::Text("Render size: %ux%u", renderSize.w, renderSize.h);
+
+  bool edgeAdaptive = postProcess.upscaler == Upscaler::EdgeAdaptive;
+  if (ImGui::Checkbox("Edge adaptive upscaling", &edgeAdaptive))
+    postProcess.upscaler =
+        edgeAdaptive ? Upscaler::EdgeAdaptive : Upscaler::Bilinear;
+  ImGui::SliderFloat("Sharpening (stops)", &postProcess.sharpness, 0, 2);
+
+  ImGui::Checkbox("Checkerboard rendering", &checkerboard.enabled);
+
+  ImGui::Checkbox("Compute post process", &postProcess.useCompute);
+  ImGui::Checkbox("Half resolution fog", &postProcess.halfResFog);
+
+  ImGui::SliderFloat("Sky intensity", &skyboxRenderer.intensity, 0, 4);
+  ImGui::SliderFloat("Background GPU budget (ms)", &scheduler.budgetMs, 0.1f,
+                     4);
+  ImGui::Text("Environment refresh: %s (%.3f ms per face)",
+              scheduler.isBusy() ? "running" : "idle",
+              scheduler.getSliceMs("environment refresh"));
+
+  ImGui::End();
+
+  ImGui::Render();
+}
+
+int main(int argc, char **argv)
+{
+  auto options = parseOptions(argc, argv);
+
+  // One mapping for the startup assets instead of a file per shader and
+  // texture
+  if (!options.looseAssets && !file::mountPack("assets.pack"))
+    printf("No asset pack, loading loose files\n");
+
+  std::unique_ptr<Benchmark> benchmark;
+  if (!options.benchmark.empty())
+  {
+    benchmark = std::make_unique<Benchmark>(options.benchmark);
+    options.frames = benchmark->getFrameCount();
+  }
+
+  Size winsize = options.resolution;
+  std::unique_ptr<Window> win;
+  std::unique_ptr<InputManager> input;
+  if (!options.headless)
+  {
+    win = std::make_unique<Window>(winsize, "My vulkan app!!");
+    if (!benchmark)
+      input = std::make_unique<InputManager>(win.get());
+  }
+
+  jobs::JobSystem jobSystem;
 
   val::EngineInitConfig init;
+  // Every worker and the main thread record scene passes
+  init.recordingThreads = jobSystem.getWorkerCount() + 1;
   init.features10.tessellationShader = true;
+  init.features10.sampleRateShading = true;
   init.presentation = val::PresentationFormat::Mailbox;
-  init.useImGUI = true;
+  init.useImGUI = !options.headless && !benchmark;
+  init.headless = options.headless;
+  init.headlessSize = winsize;
+  init.renderToSwapchain = options.renderToSwapchain;
+
+  if (benchmark)
+  {
+    // Keep vsync out of the measurements and count tessellation work
+    init.presentation = val::PresentationFormat::Immediate;
+    init.features10.pipelineStatisticsQuery = true;
+  }
 
   auto engine = std::make_unique<val::Engine>(init, win.get());
   val::BufferWriter writer(*engine);
-
-  auto framebuffer = engine->createTexture(winsize, val::TextureFormat::RGBA16);
+  // Spreads background GPU work such as environment refreshes over frames
+  val::GpuScheduler scheduler(*engine);
+  val::PassRecorder passes(*engine, jobSystem);
+  FrameGlobals frameGlobals(*engine);
+
+  val::CPUBuffer *screenshot = nullptr;
+  if (!options.screenshot.empty() && !options.headless)
+    printf("--screenshot needs --headless, no screenshot is written\n");
+  else if (!options.screenshot.empty())
+    screenshot = engine->createReadbackBuffer(engine->getFrameReadbackSize());
+
+  // Sampled with filtering as the post process upscales it when rendering at
+  // a dynamic resolution
+  // Storage usage allows deferred water shading, packed formats are not
+  // guaranteed to support it
+  auto framebuffer = engine->createTexture(
+      winsize, options.sceneFormat, val::TextureSampler::LINEAR, 1,
+      options.sceneFormat == val::TextureFormat::RGBA16
+          ? VK_IMAGE_USAGE_STORAGE_BIT
+          : 0);
   auto depthbuffer = engine->createTexture(winsize, val::TextureFormat::DEPTH32,
                                            val::TextureSampler::NEAREST, 1);
 
-  auto outputImage = engine->createTexture(winsize, val::TextureFormat::RGBA16);
+  // Storage usage lets the post process write it directly from compute, it
+  // is blitted to the swapchain on submit
+  val::Texture *outputImage = nullptr;
+  if (init.renderToSwapchain && !engine->rendersToSwapchain())
+    printf("Swapchain format cannot be rendered to, blitting the output\n");
+  if (!engine->rendersToSwapchain())
+    outputImage = engine->createTexture(winsize, val::TextureFormat::RGBA16,
+                                        val::TextureSampler::NEAREST, 1,
+                                        VK_IMAGE_USAGE_STORAGE_BIT);
   bool isOpen = true;
 
-  bool isTrue = true;
-
-  SkyboxRenderer skyboxRenderer(*engine, writer);
-  WaterRenderer waterRenderer(*engine, writer);
-  PostProcess postProcess(*engine);
+  ShaderLibrary shaders(options.hotReload);
+
+  SkyboxRenderer skyboxRenderer(*engine, jobSystem, writer, shaders,
+                                options.sceneFormat);
+  skyboxRenderer.intensity = options.skyIntensity;
+  WaterRenderer waterRenderer(*engine, shaders, options.sceneFormat);
+  waterRenderer.depthPrepass = options.depthPrepass;
+  waterRenderer.deferred = options.deferredWater;
+  PostProcess postProcess(*engine, shaders,
+                          engine->rendersToSwapchain()
+                              ? engine->getSwapchainFormat()
+                              : val::TextureFormat::RGBA16);
+  postProcess.upscaler = options.upscaler;
+  postProcess.useCompute = !options.graphicsPostProcess;
+  postProcess.halfResFog = options.halfResFog;
+
+  Checkerboard checkerboard(*engine, winsize, options.sceneFormat);
+  checkerboard.enabled = options.checkerboard;
+
+  // Created last, its cache key waits for the skybox faces that were
+  // decoding while the other pipelines were built
+  EnvironmentMap environmentMap(*engine, writer, scheduler,
+                                skyboxRenderer.getSkybox(),
+                                skyboxRenderer.getSourceHash());
+
+  DynamicResolution dynamicResolution(winsize);
+  if (options.targetGpuMs > 0)
+  {
+    dynamicResolution.enabled = true;
+    dynamicResolution.targetMs = options.targetGpuMs;
+  }
 
   Camera camera;
 
@@ -186,159 +479,218 @@ int main()
 
   auto ticks = SDL_GetTicks();
 
-  WaterMaterial material{};
-
-  material.numFreqs = 65;
-  material.baseA = 0.6;
-  material.baseW = 0.2;
-  material.aMult = 0.8;
-  material.wMult = 1.2;
-  material.diffuseColor = glm::vec4(0.f, 18.f / 255, 55.f / 255, 0.f);
-  material.baseReflectivity = 0.015;
-  material.roughness = 0.152;
-  material.speed = 2;
+  WaterMaterial material = openSeaMaterial();
 
   float time = 0;
+  uint32_t frameCount = 0;
   while (isOpen)
   {
+    auto frameStart = std::chrono::steady_clock::now();
     auto elapsed = SDL_GetTicks() - ticks;
     ticks = SDL_GetTicks();
 
-    float delta = elapsed / 1000.f;
+    float delta = benchmark ? benchmark->getTimestep() : elapsed / 1000.f;
     time += delta;
-    SDL_Event ev;
 
-    while (SDL_PollEvent(&ev))
+    if (win)
     {
-      switch (ev.type)
+      SDL_Event ev;
+
+      while (SDL_PollEvent(&ev))
       {
-      case SDL_EVENT_QUIT:
-        isOpen = false;
-        break;
+        switch (ev.type)
+        {
+        case SDL_EVENT_QUIT:
+          isOpen = false;
+          break;
+        }
+        if (init.useImGUI)
+          ImGui_ImplSDL3_ProcessEvent(&ev);
+        if (input)
+          input->handleEvent(ev);
       }
-      ImGui_ImplSDL3_ProcessEvent(&ev);
-      input.handleEvent(ev);
     }
 
     engine->update();
-    input.update();
-
-    const float speed = 15;
-
-    auto forward = camera.dir;
-    auto right = glm::normalize(glm::cross(camera.dir, glm::vec3(0, 1, 0)));
 
-    auto inputMove = input.getMoveVector();
+    if (input)
+    {
+      input->update();
 
-    camera.position += forward * inputMove.z * speed * delta +
-                       right * inputMove.x * speed * delta;
+      const float speed = 15;
 
-    camera.rotateX(input.getMouseDelta().x * 30);
-    camera.rotateY(input.getMouseDelta().y * 30);
+      auto forward = camera.dir;
+      auto right = glm::normalize(glm::cross(camera.dir, glm::vec3(0, 1, 0)));
 
-    ImGui_ImplVulkan_NewFrame();
-    ImGui_ImplSDL3_NewFrame();
-    ImGui::NewFrame();
-    ImGui::Begin("vkRaster", &isTrue);
+      auto inputMove = input->getMoveVector();
 
-    ImGui::Text("FPS: %d", (uint32_t)(1 / std::max(delta, 0.0001f)));
+      camera.position += forward * inputMove.z * speed * delta +
+                         right * inputMove.x * speed * delta;
 
-    if (ImGui::Button("Open sea")) {
-      material.numFreqs = 65;
-      material.baseA = 0.6;
-      material.baseW = 0.2;
-      material.aMult = 0.8;
-      material.wMult = 1.2;
-      material.diffuseColor = glm::vec4(0.f, 18.f / 255, 55.f / 255, 0.f);
-      material.baseReflectivity = 0.015;
-      material.roughness = 0.152;
-      material.speed = 2;
+      camera.rotateX(input->getMouseDelta().x * 30);
+      camera.rotateY(input->getMouseDelta().y * 30);
     }
 
-    if (ImGui::Button("Calm lake")) {
-      material.numFreqs = 12;
-      material.baseA = 0.06;
-      material.baseW = 0.5;
-      material.aMult = 0.8;
-      material.wMult = 1.2;
-      material.diffuseColor = glm::vec4(0.f, 54.f / 255, 89.f / 255, 0.f);
-      material.baseReflectivity = 0.02;
-      material.roughness = 0.06;
-      material.speed = 0.9;
+    if (benchmark)
+    {
+      benchmark->getCamera(frameCount, camera.position, camera.dir);
+      material = benchmark->getMaterial(frameCount);
     }
 
-    // Draw material params
-
-    ImGui::SliderInt("Number of waves", (int *)&material.numFreqs, 1, 128);
-
-    ImGui::SliderFloat("A", &material.baseA, 0, 1);
-    ImGui::InputFloat("W", &material.baseW);
-
-    ImGui::InputFloat("A Mult", &material.aMult);
-    ImGui::InputFloat("W Mult", &material.wMult);
-
-    ImGui::ColorPicker3("Diffuse color", glm::value_ptr(material.diffuseColor));
-
-    ImGui::InputFloat("F0", &material.baseReflectivity);
-
-    ImGui::SliderFloat("Roughness", &material.roughness, 0, 1);
+    dynamicResolution.update(engine->getGpuProfile());
 
-    ImGui::InputFloat("Speed", &material.speed);
-
-    ImGui::End();
-
-    ImGui::Render();
+    if (init.useImGUI)
+      drawUi(material, waterRenderer, dynamicResolution, postProcess,
+             checkerboard, skyboxRenderer, scheduler, delta);
+    environmentMap.setSkyIntensity(skyboxRenderer.intensity);
 
     waterRenderer.updateMaterial(material);
 
+    // Swapped in before recording so a frame never mixes old and new
+    // pipelines
+    if (shaders.update())
+    {
+      waterRenderer.reloadShaders();
+      skyboxRenderer.reloadShaders();
+      postProcess.reloadShaders();
+    }
+
     auto cmd = engine->initFrame();
 
     if (cmd.isValid())
     {
 
       writer.updateWrites(cmd);
+      environmentMap.update(cmd);
+      scheduler.update(cmd);
 
       RenderState rs;
       rs.cmd = &cmd;
+      rs.passes = &passes;
       rs.colorBuffer = framebuffer;
       rs.depthBuffer = depthbuffer;
+      rs.renderSize = dynamicResolution.getRenderSize();
       rs.projectionMatrix = camera.getProjection();
       rs.viewMatrix = camera.getView();
       rs.camPos = camera.position;
       rs.camDir = camera.dir;
       rs.time = time;
-      rs.ambientMap = skyboxRenderer.getSkybox();
+      rs.ambientMap = environmentMap.getPrefiltered();
+      rs.brdfLut = environmentMap.getBrdfLut();
+
+      checkerboard.begin(rs);
+      frameGlobals.update(rs);
 
       cmd.transitionTexture(framebuffer, vk::ImageLayout::eUndefined,
                             vk::ImageLayout::eColorAttachmentOptimal);
 
+      cmd.beginProfile("patches");
       waterRenderer.generatePatches(rs);
-      skyboxRenderer.renderSkybox(rs);
-
-      cmd.memoryBarrier(vk::PipelineStageFlagBits2::eComputeShader,
-                        vk::AccessFlagBits2::eMemoryWrite,
-                        vk::PipelineStageFlagBits2::eVertexAttributeInput,
-                        vk::AccessFlagBits2::eMemoryRead |
-                            vk::AccessFlagBits2::eMemoryWrite);
+      cmd.endProfile();
 
-      cmd.memoryBarrier(vk::PipelineStageFlagBits2::eLateFragmentTests,
-                        vk::AccessFlagBits2::eMemoryWrite,
-                        vk::PipelineStageFlagBits2::eEarlyFragmentTests,
-                        vk::AccessFlagBits2::eMemoryWrite);
+      // The scene passes are queued and recorded in parallel, everything
+      // around them goes through the recorder to keep its place
+      passes.primary([](val::CommandBuffer &cmd)
+                     { cmd.beginProfile("skybox"); });
+      skyboxRenderer.renderSkybox(rs);
+      passes.primary(
+          [](val::CommandBuffer &cmd)
+          {
+            cmd.endProfile();
+
+            cmd.memoryBarrier(vk::PipelineStageFlagBits2::eComputeShader,
+                              vk::AccessFlagBits2::eMemoryWrite,
+                              vk::PipelineStageFlagBits2::eVertexAttributeInput,
+                              vk::AccessFlagBits2::eMemoryRead |
+                                  vk::AccessFlagBits2::eMemoryWrite);
+
+            cmd.memoryBarrier(vk::PipelineStageFlagBits2::eLateFragmentTests,
+                              vk::AccessFlagBits2::eMemoryWrite,
+                              vk::PipelineStageFlagBits2::eEarlyFragmentTests,
+                              vk::AccessFlagBits2::eMemoryWrite);
+            cmd.beginProfile("water");
+            cmd.beginStatistics("water");
+          });
       waterRenderer.renderWater(rs);
+      passes.primary(
+          [](val::CommandBuffer &cmd)
+          {
+            cmd.endStatistics();
+            cmd.endProfile();
+
+            cmd.memoryBarrier(vk::PipelineStageFlagBits2::eLateFragmentTests,
+                              vk::AccessFlagBits2::eMemoryWrite,
+                              vk::PipelineStageFlagBits2::eEarlyFragmentTests,
+                              vk::AccessFlagBits2::eMemoryRead);
+          });
+      passes.record(cmd);
+
+      if (checkerboard.enabled)
+      {
+        cmd.beginProfile("checkerboard");
+        checkerboard.resolve(rs, waterRenderer.getMaterial());
+        cmd.endProfile();
+      }
 
-      cmd.memoryBarrier(vk::PipelineStageFlagBits2::eLateFragmentTests,
-                        vk::AccessFlagBits2::eMemoryWrite,
-                        vk::PipelineStageFlagBits2::eEarlyFragmentTests,
-                        vk::AccessFlagBits2::eMemoryRead);
+      auto output = outputImage ? outputImage : engine->getSwapchainTarget();
+      cmd.transitionTexture(output, vk::ImageLayout::eUndefined,
+                            vk::ImageLayout::eColorAttachmentOptimal);
+
+      cmd.beginProfile("postprocess");
+      postProcess.renderPostProcess(rs, output);
+      cmd.endProfile();
 
-      postProcess.renderPostProcess(rs, outputImage);
+      if (screenshot && frameCount + 1 == options.frames)
+        engine->readbackFrame(screenshot);
+      engine->submitFrame(output);
+    }
 
-      engine->submitFrame(outputImage);
+    if (benchmark)
+    {
+      std::chrono::duration<double, std::milli> cpuTime =
+          std::chrono::steady_clock::now() - frameStart;
+      benchmark->recordCpuFrame(frameCount, cpuTime.count());
+      benchmark->recordGpuFrame(engine->getGpuProfile());
+      benchmark->recordAllocations(frameCount, engine->getAllocationStats());
     }
+
+    frameCount++;
+    if (options.frames && frameCount >= options.frames)
+      isOpen = false;
   }
 
   engine->waitFinishAllCommands();
 
+  if (screenshot)
+  {
+    std::vector<uint8_t> pixels(screenshot->size);
+    engine->readCPUBuffer(screenshot, pixels.data(), pixels.size());
+    if (!writeScreenshot(options.screenshot, winsize, pixels))
+      printf("Cannot write screenshot %s\n", options.screenshot.c_str());
+    engine->destroyCpuBuffer(screenshot);
+  }
+
+  if (benchmark)
+  {
+    // The last frames in flight only report their GPU results now
+    for (auto &profile : engine->collectGpuProfiles())
+      benchmark->recordGpuFrame(profile);
+
+    benchmark->writeReport(options.report, engine->getDeviceName());
+
+    if (!options.writeBaseline.empty())
+      benchmark->writeBaseline(options.writeBaseline);
+
+    bool passed = true;
+    if (!options.baseline.empty())
+      passed = benchmark->compareBaseline(options.baseline, options.tolerance);
+    if (!options.referenceDir.empty())
+      passed = benchmark->checkReference(options.referenceDir,
+                                         engine->getDeviceName()) &&
+               passed;
+    if (!passed)
+      return 1;
+  }
+
   return 0;
 }
@@ -2,19 +2,39 @@
 
 #include "val/vulkan_abstraction.hpp"
 
+// Sample count of the half resolution checkerboard targets, the standard 2x
+// sample positions cover one diagonal of each 2x2 block of output pixels
+constexpr uint32_t CHECKERBOARD_SAMPLES = 2;
+
 struct RenderState {
   val::Texture *colorBuffer;
   val::Texture *depthBuffer;
 
+  // Area of colorBuffer and depthBuffer the scene is rendered to, starting
+  // at the top left corner
+  Size renderSize;
+
   glm::mat4 projectionMatrix;
   glm::mat4 viewMatrix;
+  // Clip space offset of the scene passes on top of projectionMatrix
+  glm::vec2 jitter{};
 
   glm::vec3 camPos;
   glm::vec3 camDir;
 
   val::CommandBuffer *cmd;
+  // Scene passes are queued here and recorded on the job system, see
+  // val::PassRecorder
+  val::PassRecorder *passes;
 
   float time = 0;
 
+  // Camera and time of the frame in the layout of frameGlobals.h, see
+  // FrameGlobals
+  val::BindPoint<val::StorageBuffer> globals{};
+
+  // Prefiltered environment cubemap, mip levels increase in roughness up to
+  // 1 at the last one, and the split sum lookup table
   val::Texture *ambientMap;
+  val::Texture *brdfLut;
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "binding.hpp"
 
+#include <algorithm>
 #include <vector>
 
 #include "types.hpp"
@@ -8,6 +9,7 @@ namespace val {
 
 constexpr uint32_t TEXTURE_BIND = 0;
 constexpr uint32_t STORAGE_BIND = 1;
+constexpr uint32_t STORAGE_IMAGE_BIND = 2;
 
 constexpr size_t MAX_DESCRIPTORS_PER_TYPE = 4096;
 
@@ -45,6 +47,15 @@ void GlobalBinding::init(const vk::raii::Device& device,
     storageBind.stageFlags = vk::ShaderStageFlagBits::eAll;
     bindingFlags.push_back(vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eUpdateAfterBind);
 
+    auto& storageImageBind = layoutBindings.emplace_back();
+    storageImageBind.binding = STORAGE_IMAGE_BIND;
+    storageImageBind.descriptorType = vk::DescriptorType::eStorageImage;
+    storageImageBind.descriptorCount = std::min<uint32_t>(
+        properties.limits.maxDescriptorSetStorageImages,
+        MAX_DESCRIPTORS_PER_TYPE);
+    storageImageBind.stageFlags = vk::ShaderStageFlagBits::eAll;
+    bindingFlags.push_back(vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eUpdateAfterBind);
+
     vk::DescriptorSetLayoutCreateInfo layoutCreateInfo;
     layoutCreateInfo.flags =
         vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool;
@@ -70,6 +81,10 @@ void GlobalBinding::init(const vk::raii::Device& device,
     size->type = vk::DescriptorType::eStorageBuffer;
     size->descriptorCount = MAX_DESCRIPTORS_PER_TYPE;
 
+    size = &sizes.emplace_back();
+    size->type = vk::DescriptorType::eStorageImage;
+    size->descriptorCount = MAX_DESCRIPTORS_PER_TYPE;
+
     vk::DescriptorPoolCreateInfo poolCreateInfo;
     poolCreateInfo.flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind |
                            vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet;
@@ -94,6 +109,7 @@ void GlobalBinding::init(const vk::raii::Device& device,
     nearestSampler = device.createSampler(sampler);
 
     sampler.magFilter = sampler.minFilter = vk::Filter::eLinear;
+    sampler.mipmapMode = vk::SamplerMipmapMode::eLinear;
     linearSampler = device.createSampler(sampler);
 }
 
@@ -143,4 +159,25 @@ BindPoint<StorageBuffer> GlobalBinding::bindStorageBuffer(
 
     return {bindPoint};
 }
+
+BindPoint<StorageImage> GlobalBinding::bindStorageImage(vk::ImageView image) {
+    uint32_t bindPoint = getFirstFree(storageImageBinds);
+    vk::WriteDescriptorSet write;
+
+    vk::DescriptorImageInfo imageInfo;
+
+    imageInfo.imageView = image;
+    imageInfo.imageLayout = vk::ImageLayout::eGeneral;
+
+    write.dstSet = *descriptorSet;
+    write.descriptorType = vk::DescriptorType::eStorageImage;
+    write.dstBinding = STORAGE_IMAGE_BIND;
+    write.dstArrayElement = bindPoint;
+    write.descriptorCount = 1;
+    write.pImageInfo = &imageInfo;
+
+    device.updateDescriptorSets({write}, {});
+
+    return {bindPoint};
+}
 }  // namespace val
@@ -16,6 +16,7 @@ class GlobalBinding {
 
     std::vector<bool> textureBinds;
     std::vector<bool> storageBinds;
+    std::vector<bool> storageImageBinds;
 
     GlobalBinding() = default;
 
@@ -26,6 +27,7 @@ class GlobalBinding {
     BindPoint<Texture> bindTexture(vk::ImageView texture,
                                    TextureSampler sampling);
     BindPoint<StorageBuffer> bindStorageBuffer(vk::Buffer storageBuffer);
+    BindPoint<StorageImage> bindStorageImage(vk::ImageView image);
 
     void removeBind(BindPoint<Texture> bindPoint) {
         if (!bindPoint.bind) return;
@@ -35,10 +37,15 @@ class GlobalBinding {
         if (!bindPoint.bind) return;
         storageBinds[bindPoint.bind - 1] = false;
     }
+    void removeBind(BindPoint<StorageImage> bindPoint) {
+        if (!bindPoint.bind) return;
+        storageImageBinds[bindPoint.bind - 1] = false;
+    }
 
     void clearBounds() {
         storageBinds.clear();
         textureBinds.clear();
+        storageImageBinds.clear();
     }
 
     vk::DescriptorSetLayout getLayout() { return *layout; }
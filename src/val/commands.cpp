@@ -1,5 +1,6 @@
 #include "commands.hpp"
 
+#include "helpers.hpp"
 #include "pipelines.hpp"
 namespace val {
 void CommandBuffer::begin() {
@@ -15,7 +16,7 @@ void CommandBuffer::transitionImage(vk::Image image, uint32_t layer,
                                     vk::PipelineStageFlagBits2 srcStage,
                                     vk::ImageLayout dstLayout,
                                     vk::PipelineStageFlagBits2 dstStage,
-                                    bool depth) {
+                                    bool depth, uint32_t layerCount) {
   vk::ImageMemoryBarrier2KHR imageBarrier;
   imageBarrier.srcAccessMask = vk::AccessFlagBits2::eMemoryWrite;
   imageBarrier.srcStageMask = srcStage;
@@ -29,7 +30,7 @@ void CommandBuffer::transitionImage(vk::Image image, uint32_t layer,
 
   vk::ImageSubresourceRange range;
   range.levelCount = mipLevels;
-  range.layerCount = 1;
+  range.layerCount = layerCount;
   range.baseArrayLayer = layer;
   range.aspectMask =
       depth ? vk::ImageAspectFlagBits::eDepth : vk::ImageAspectFlagBits::eColor;
@@ -64,7 +65,38 @@ void CommandBuffer::copyToTexture(Texture *t, vk::Buffer origin,
   cmd.copyBufferToImage(origin, t->image, vk::ImageLayout::eTransferDstOptimal,
                         {copyRegion});
 
-  generateMipMapLevels(t);
+  generateMipMapLevels(t, dstLayer);
+}
+
+// One region per mip level covering every layer
+static std::vector<vk::BufferImageCopy> levelRegions(Texture *t) {
+  std::vector<vk::BufferImageCopy> regions;
+  vk::DeviceSize offset = 0;
+  for (uint32_t level = 0; level < t->mipLevels; level++) {
+    auto size = helpers::getMipSize(t->size, level);
+
+    auto &region = regions.emplace_back();
+    region.bufferOffset = offset;
+    region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+    region.imageSubresource.mipLevel = level;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = t->layers;
+    region.imageExtent = vk::Extent3D(size.w, size.h, 1);
+
+    offset +=
+        helpers::getTextureSizeFromSizeAndFormat(size, t->format) * t->layers;
+  }
+  return regions;
+}
+
+void CommandBuffer::copyLevelsToTexture(Texture *t, vk::Buffer buffer) {
+  cmd.copyBufferToImage(buffer, t->image, vk::ImageLayout::eTransferDstOptimal,
+                        levelRegions(t));
+}
+
+void CommandBuffer::copyTextureLevelsToBuffer(Texture *t, vk::Buffer buffer) {
+  cmd.copyImageToBuffer(t->image, vk::ImageLayout::eTransferSrcOptimal, buffer,
+                        levelRegions(t));
 }
 
 void CommandBuffer::memoryBarrier(vk::PipelineStageFlags2 srcStage,
@@ -92,7 +124,7 @@ void CommandBuffer::copyTextureToTexture(Texture *src, Texture *dst,
   region.srcOffsets[1] = {
       .x = (int32_t)src->size.w, .y = (int32_t)src->size.h, .z = (int32_t)1};
 
-  region.dstSubresource.baseArrayLayer = srcLayer;
+  region.dstSubresource.baseArrayLayer = dstLayer;
   region.dstSubresource.layerCount = 1;
   region.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
   region.dstOffsets[0] = {.x = 0, .y = 0, .z = 0};
@@ -110,7 +142,7 @@ void CommandBuffer::copyTextureToTexture(Texture *src, Texture *dst,
 
   cmd.blitImage2(blitInfo);
 
-  generateMipMapLevels(dst);
+  generateMipMapLevels(dst, dstLayer);
 }
 
 void CommandBuffer::copyBufferToBuffer(StorageBuffer *dst, vk::Buffer src,
@@ -161,7 +193,7 @@ void CommandBuffer::clearImage(vk::Image image, float r, float g, float b,
                       range);
 }
 
-void CommandBuffer::generateMipMapLevels(Texture *tex) {
+void CommandBuffer::generateMipMapLevels(Texture *tex, uint32_t layer) {
   if (tex->mipLevels <= 1) {
     return;
   }
@@ -170,7 +202,7 @@ void CommandBuffer::generateMipMapLevels(Texture *tex) {
   barrier.srcQueueFamilyIndex = vk::QueueFamilyIgnored;
   barrier.dstQueueFamilyIndex = vk::QueueFamilyIgnored;
   barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.baseArrayLayer = layer;
   barrier.subresourceRange.layerCount = 1;
   barrier.subresourceRange.levelCount = 1;
 
@@ -194,14 +226,14 @@ void CommandBuffer::generateMipMapLevels(Texture *tex) {
     blit.srcOffsets[1] = vk::Offset3D(mipWidth, mipHeight, 1);
     blit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
     blit.srcSubresource.mipLevel = i - 1;
-    blit.srcSubresource.baseArrayLayer = 0;
+    blit.srcSubresource.baseArrayLayer = layer;
     blit.srcSubresource.layerCount = 1;
     blit.dstOffsets[0] = vk::Offset3D(0, 0, 0);
     blit.dstOffsets[1] = vk::Offset3D(mipWidth > 1 ? mipWidth / 2 : 1,
                                       mipHeight > 1 ? mipHeight / 2 : 1, 1);
     blit.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
     blit.dstSubresource.mipLevel = i;
-    blit.dstSubresource.baseArrayLayer = 0;
+    blit.dstSubresource.baseArrayLayer = layer;
     blit.dstSubresource.layerCount = 1;
 
     cmd.blitImage(tex->image, vk::ImageLayout::eTransferSrcOptimal, tex->image,
@@ -215,9 +247,10 @@ void CommandBuffer::generateMipMapLevels(Texture *tex) {
   }
 }
 
-void CommandBuffer::beginPass(std::span<Texture *> framebuffers,
-                              Texture *depthBuffer, bool clearDepth) {
-  Size area;
+void CommandBuffer::beginRendering(std::span<Texture *const> framebuffers,
+                                   Texture *depthBuffer, bool clearDepth,
+                                   Size area, vk::RenderingFlags flags) {
+  Size attachmentSize = depthBuffer ? depthBuffer->size : Size{};
   vk::RenderingInfo renderInfo;
   std::vector<vk::RenderingAttachmentInfo> colorAttachments(
       framebuffers.size());
@@ -229,7 +262,10 @@ void CommandBuffer::beginPass(std::span<Texture *> framebuffers,
     auto texture = framebuffers[i];
     attachInfo.imageView = *texture->imageView;
     colorAttachments[i] = attachInfo;
-    area = texture->size;
+    attachmentSize = texture->size;
+  }
+  if (area.w == 0 || area.h == 0) {
+    area = attachmentSize;
   }
   renderInfo.colorAttachmentCount = colorAttachments.size();
   renderInfo.pColorAttachments = colorAttachments.data();
@@ -246,12 +282,59 @@ void CommandBuffer::beginPass(std::span<Texture *> framebuffers,
   }
 
   renderInfo.renderArea = {.offset = {0, 0}, .extent = {area.w, area.h}};
+  renderInfo.flags = flags;
 
   cmd.beginRendering(renderInfo);
 }
 
+void CommandBuffer::beginPass(std::span<Texture *> framebuffers,
+                              Texture *depthBuffer, bool clearDepth,
+                              Size area) {
+  beginRendering(framebuffers, depthBuffer, clearDepth, area, {});
+}
+
+void CommandBuffer::beginSecondaryPass(std::span<Texture *const> framebuffers,
+                                       Texture *depthBuffer, bool clearDepth,
+                                       Size area) {
+  beginRendering(framebuffers, depthBuffer, clearDepth, area,
+                 vk::RenderingFlagBits::eContentsSecondaryCommandBuffers);
+}
+
+void CommandBuffer::executeSecondaries(
+    std::span<const vk::CommandBuffer> secondaries) {
+  cmd.executeCommands((uint32_t)secondaries.size(), secondaries.data());
+}
+
+PassInheritance
+PassInheritance::fromAttachments(std::span<Texture *const> framebuffers,
+                                 Texture *depthBuffer) {
+  PassInheritance pass;
+  uint32_t samples = depthBuffer ? depthBuffer->samples : 1;
+  for (auto texture : framebuffers) {
+    pass.colorFormats.push_back(vk::Format(texture->format));
+    samples = texture->samples;
+  }
+  if (depthBuffer) {
+    pass.depthFormat = vk::Format(depthBuffer->format);
+  }
+  pass.samples = vk::SampleCountFlagBits(samples);
+  return pass;
+}
+
 void CommandBuffer::endPass() { cmd.endRendering(); }
 
+void CommandBuffer::beginProfile(const char *name) {
+  engine.profiler.beginScope(cmd, name);
+}
+
+void CommandBuffer::endProfile() { engine.profiler.endScope(cmd); }
+
+void CommandBuffer::beginStatistics(const char *name) {
+  engine.profiler.beginStatistics(cmd, name);
+}
+
+void CommandBuffer::endStatistics() { engine.profiler.endStatistics(cmd); }
+
 void CommandBuffer::_bindPipeline(GraphicsPipeline &pipeline) {
   cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, *pipeline.pipeline);
   auto ds = *engine.bindings.descriptorSet;
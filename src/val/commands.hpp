@@ -4,6 +4,18 @@
 namespace val {
 class GraphicsPipeline;
 class ComputePipeline;
+
+// Attachment formats of a pass whose contents are recorded into secondary
+// command buffers, the secondaries are begun against them
+struct PassInheritance {
+  std::vector<vk::Format> colorFormats;
+  vk::Format depthFormat = vk::Format::eUndefined;
+  vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+
+  static PassInheritance fromAttachments(std::span<Texture *const> framebuffers,
+                                         Texture *depthBuffer);
+};
+
 class CommandBuffer {
   friend class Engine;
 
@@ -12,12 +24,16 @@ private:
   CommandBuffer(Engine &e, vk::CommandBuffer cmd) : engine(e), cmd(cmd) {}
 
   void begin();
+  void beginRendering(std::span<Texture *const> framebuffers,
+                      Texture *depthBuffer, bool clearDepth, Size area,
+                      vk::RenderingFlags flags);
 
   void transitionImage(vk::Image image, uint32_t layer, uint32_t mipLevels,
                        vk::ImageLayout srcLayout,
                        vk::PipelineStageFlagBits2 srcStage,
                        vk::ImageLayout dstLayout,
-                       vk::PipelineStageFlagBits2 dstStage, bool depth = 0);
+                       vk::PipelineStageFlagBits2 dstStage, bool depth = 0,
+                       uint32_t layerCount = 1);
 
   inline void transitionImage(vk::Image image, uint32_t layer,
                               uint32_t mipLevels, vk::ImageLayout srcLayout,
@@ -36,6 +52,8 @@ private:
                      vk::PipelineStageFlagBits2 dstStage =
                          vk::PipelineStageFlagBits2::eAllCommands,
                      uint32_t dstLayer = 0);
+  void copyLevelsToTexture(Texture *t, vk::Buffer buffer);
+  void copyTextureLevelsToBuffer(Texture *t, vk::Buffer buffer);
   void _bindPipeline(GraphicsPipeline &p);
   void _bindPipeline(ComputePipeline &p);
   void _pushConstants(GraphicsPipeline &p, const void *data, uint32_t size);
@@ -60,6 +78,30 @@ public:
                     texture->format == TextureFormat::DEPTH32);
   }
 
+  // Every layer and mip level at once
+  inline void transitionTextureLevels(Texture *texture,
+                                      vk::ImageLayout srcLayout,
+                                      vk::PipelineStageFlagBits2 srcStage,
+                                      vk::ImageLayout dstLayout,
+                                      vk::PipelineStageFlagBits2 dstStage) {
+    transitionImage(texture->image, 0, texture->mipLevels, srcLayout, srcStage,
+                    dstLayout, dstStage,
+                    texture->format == TextureFormat::DEPTH32,
+                    texture->layers);
+  }
+
+  // The buffer holds the mip levels in order, each with its layers tightly
+  // packed. The texture must be in transfer dst layout, no mips are generated
+  void copyLevelsToTexture(Texture *t, CPUBuffer *buffer) {
+    copyLevelsToTexture(t, buffer->buffer);
+  }
+
+  // Same layout as copyLevelsToTexture, the texture must be in transfer src
+  // layout
+  void copyTextureLevelsToBuffer(Texture *t, CPUBuffer *buffer) {
+    copyTextureLevelsToBuffer(t, buffer->buffer);
+  }
+
   void copyToTexture(Texture *t, CPUBuffer *buffer,
                      vk::PipelineStageFlagBits2 srcStage =
                          vk::PipelineStageFlagBits2::eAllCommands,
@@ -102,13 +144,33 @@ public:
 
   bool isValid() { return cmd != 0; }
 
-  void generateMipMapLevels(Texture *tex);
+  void generateMipMapLevels(Texture *tex, uint32_t layer = 0);
 
+  // An empty area renders to the whole attachment
   void beginPass(std::span<Texture *> framebuffers, Texture *depthBuffer = 0,
-                 bool clearDepth = false);
+                 bool clearDepth = false, Size area = {});
+
+  // Same as beginPass, the contents come from executeSecondaries
+  void beginSecondaryPass(std::span<Texture *const> framebuffers,
+                          Texture *depthBuffer = 0, bool clearDepth = false,
+                          Size area = {});
+  // Secondaries from Engine::beginSecondary, executed in order
+  void executeSecondaries(std::span<const vk::CommandBuffer> secondaries);
 
   void endPass();
 
+  // Finishes a secondary command buffer from Engine::beginSecondary
+  void end() { cmd.end(); }
+
+  // Named GPU timestamp scope, scopes can be nested and must be closed in
+  // the same frame
+  void beginProfile(const char *name);
+  void endProfile();
+
+  // Pipeline statistics over the enclosed commands, only one can be open
+  void beginStatistics(const char *name);
+  void endStatistics();
+
   void bindPipeline(GraphicsPipeline &pipeline) { _bindPipeline(pipeline); }
   void bindPipeline(ComputePipeline &pipeline) { _bindPipeline(pipeline); }
   template <typename T>
@@ -1,6 +1,7 @@
 #include "gpu_resources.hpp"
 
 #include <cassert>
+#include <cstring>
 
 #include "helpers.hpp"
 #include "system.hpp"
@@ -22,6 +23,20 @@ void BufferWriter::updateWrites(CommandBuffer &cmd) {
   }
   textureWrites.clear();
 
+  for (auto &[texture, buffer] : textureLevelsWrites) {
+    cmd.transitionTextureLevels(texture, vk::ImageLayout::eUndefined,
+                                vk::PipelineStageFlagBits2::eAllCommands,
+                                vk::ImageLayout::eTransferDstOptimal,
+                                vk::PipelineStageFlagBits2::eTransfer);
+    cmd.copyLevelsToTexture(texture, buffer);
+    cmd.transitionTextureLevels(texture, vk::ImageLayout::eTransferDstOptimal,
+                                vk::PipelineStageFlagBits2::eTransfer,
+                                vk::ImageLayout::eShaderReadOnlyOptimal,
+                                vk::PipelineStageFlagBits2::eAllCommands);
+    engine.destroyCpuBuffer(buffer);
+  }
+  textureLevelsWrites.clear();
+
   for (auto &[buffer, start, size, upload] : bufferWrites) {
     cmd.copyBufferToBuffer(buffer, upload, start, 0, size);
     engine.destroyCpuBuffer(upload);
@@ -45,13 +60,29 @@ void BufferWriter::updateWrites(CommandBuffer &cmd) {
 
 void BufferWriter::enqueueTextureWrite(Texture *tex, const void *data,
                                        uint32_t layer) {
+  auto staging = mapTextureWrite(tex, layer);
+  memcpy(staging.data(), data, staging.size());
+}
+
+std::span<uint8_t> BufferWriter::mapTextureWrite(Texture *tex,
+                                                 uint32_t layer) {
   const auto size =
       helpers::getTextureSizeFromSizeAndFormat(tex->size, tex->format);
 
+  auto upload = engine.createCpuBuffer(size);
+  textureWrites.push_back({.texture = tex, .buffer = upload, .layer = layer});
+
+  return {(uint8_t *)upload->buffer.allocInfo.pMappedData, size};
+}
+
+void BufferWriter::enqueueTextureLevelsWrite(Texture *tex, const void *data) {
+  const auto size = helpers::getTextureLevelsSize(tex->size, tex->format,
+                                                  tex->layers, tex->mipLevels);
+
   auto upload = engine.createCpuBuffer(size);
   engine.updateCPUBuffer(upload, data, size);
 
-  textureWrites.push_back({.texture = tex, .buffer = upload, .layer = layer});
+  textureLevelsWrites.push_back({.texture = tex, .buffer = upload});
 }
 
 void BufferWriter::enqueueBufferWrite(StorageBuffer *buffer, const void *data,
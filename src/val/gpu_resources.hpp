@@ -5,6 +5,10 @@
 #include "raii.hpp"
 #include "types.hpp"
 namespace val {
+// Tag for storage image bind points, images are bound both as a sampled
+// texture and, when created with storage usage, as a storage image
+struct StorageImage;
+
 struct StorageBuffer {
   BindPoint<StorageBuffer> bindPoint{};
   raii::Buffer buffer{};
@@ -14,6 +18,7 @@ struct StorageBuffer {
 
 struct Texture {
   BindPoint<Texture> bindPoint{};
+  BindPoint<StorageImage> storageBindPoint{};
   raii::Image image{};
   vk::raii::ImageView imageView{nullptr};
   Size size{};
@@ -21,6 +26,13 @@ struct Texture {
   TextureSampler sampler{};
   uint32_t mipLevels{};
   uint32_t layers{};
+  uint32_t samples = 1;
+  // Created with storage usage, storageBindPoint is valid
+  bool storage = false;
+  // Single level views of every mip, only for storage textures with more
+  // than one mip level. Layered textures are bound as image2DArray
+  std::vector<vk::raii::ImageView> mipViews;
+  std::vector<BindPoint<StorageImage>> mipStorageBindPoints;
 };
 
 struct Mesh {
@@ -52,6 +64,12 @@ private:
     CPUBuffer *uploadBuffer;
   };
 
+  // Every layer and mip level of the texture from one buffer
+  struct TextureLevelsWrite {
+    Texture *texture;
+    CPUBuffer *buffer;
+  };
+
   struct MeshWrite {
     Mesh *mesh;
     CPUBuffer *verticesUpload;
@@ -59,6 +77,7 @@ private:
   };
 
   std::vector<TextureWriteOperation> textureWrites;
+  std::vector<TextureLevelsWrite> textureLevelsWrites;
   std::vector<BufferWrite> bufferWrites;
   std::vector<MeshWrite> meshWrites;
 
@@ -70,6 +89,12 @@ public:
   void updateWrites(CommandBuffer &cmd);
 
   void enqueueTextureWrite(Texture *tex, const void *data, uint32_t layer = 0);
+  // Same as enqueueTextureWrite, the caller fills the returned staging
+  // memory before the next updateWrites instead of passing a copy
+  std::span<uint8_t> mapTextureWrite(Texture *tex, uint32_t layer = 0);
+  // data holds the mip levels in order, each with its layers tightly packed,
+  // no mips are generated
+  void enqueueTextureLevelsWrite(Texture *tex, const void *data);
   void enqueueBufferWrite(StorageBuffer *buffer, const void *data,
                           uint32_t start, size_t size);
 
@@ -1,5 +1,7 @@
 #include "helpers.hpp"
 
+#include <algorithm>
+
 namespace val {
 namespace helpers {
 size_t getTextureSizeFromSizeAndFormat(const Size s, TextureFormat format) {
@@ -10,5 +12,19 @@ size_t getTextureSizeFromSizeAndFormat(const Size s, TextureFormat format) {
 
     return s.w * s.h * pixelSize;
 }
+
+size_t getTextureLevelsSize(const Size s, TextureFormat format,
+                            uint32_t layers, uint32_t mipLevels) {
+    size_t size = 0;
+    for (uint32_t level = 0; level < mipLevels; level++) {
+        size += getTextureSizeFromSizeAndFormat(getMipSize(s, level), format) *
+                layers;
+    }
+    return size;
+}
+
+Size getMipSize(const Size s, uint32_t level) {
+    return {.w = std::max(s.w >> level, 1u), .h = std::max(s.h >> level, 1u)};
+}
 }  // namespace helpers
 }  // namespace val
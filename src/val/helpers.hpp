@@ -4,5 +4,9 @@
 namespace val {
 namespace helpers {
 size_t getTextureSizeFromSizeAndFormat(const Size s, TextureFormat format);
+// Size of every layer and mip level, in the layout used by the level copies
+size_t getTextureLevelsSize(const Size s, TextureFormat format,
+                            uint32_t layers, uint32_t mipLevels);
+Size getMipSize(const Size s, uint32_t level);
 }  // namespace helpers
 }  // namespace val
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#include "system.hpp"
+
+namespace val {
+
+// Parameters shaders read from a storage buffer, such as a material. Every
+// frame in flight has its own copy in mapped host visible memory, so a change
+// is a memcpy into the copy of the frame being recorded instead of a staged
+// upload, and an unchanged block costs nothing.
+//
+// set compares bytewise against the current values, padding included. Each
+// copy keeps the byte range it is missing until update writes it.
+template <typename T> class ParamBlock {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "ParamBlock copies its values bytewise");
+
+private:
+  Engine &engine;
+  StorageBuffer *buffers[FRAMES_IN_FLIGHT];
+  T values;
+  uint64_t version = 0;
+  // Bytes of each copy older than values, empty when start equals end
+  size_t dirtyStart[FRAMES_IN_FLIGHT]{};
+  size_t dirtyEnd[FRAMES_IN_FLIGHT]{};
+
+public:
+  ParamBlock(Engine &engine, const T &initial = T{})
+      : engine(engine), values(initial) {
+    for (size_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
+      buffers[i] = engine.createHostStorageBuffer(sizeof(T));
+      dirtyEnd[i] = sizeof(T);
+    }
+  }
+  ~ParamBlock() {
+    for (auto buffer : buffers) {
+      engine.destroyStorageBuffer(buffer);
+    }
+  }
+
+  ParamBlock(const ParamBlock &) = delete;
+  ParamBlock &operator=(const ParamBlock &) = delete;
+
+  const T &get() const { return values; }
+  // Incremented by every set that changes a byte
+  uint64_t getVersion() const { return version; }
+
+  // Returns whether anything changed, can be called at any point of a frame
+  bool set(const T &newValues) {
+    auto current = reinterpret_cast<const uint8_t *>(&values);
+    auto next = reinterpret_cast<const uint8_t *>(&newValues);
+    size_t start = 0;
+    while (start < sizeof(T) && current[start] == next[start]) {
+      start++;
+    }
+    if (start == sizeof(T)) {
+      return false;
+    }
+    size_t end = sizeof(T);
+    while (current[end - 1] == next[end - 1]) {
+      end--;
+    }
+
+    memcpy(&values, &newValues, sizeof(T));
+    version++;
+    for (size_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
+      if (dirtyStart[i] == dirtyEnd[i]) {
+        dirtyStart[i] = start;
+        dirtyEnd[i] = end;
+      } else {
+        dirtyStart[i] = std::min(dirtyStart[i], start);
+        dirtyEnd[i] = std::max(dirtyEnd[i], end);
+      }
+    }
+    return true;
+  }
+
+  // Writes the missing bytes into the copy of the frame being recorded and
+  // returns its bind point. Call between initFrame and submitFrame, the
+  // frame that last read the copy has finished by then
+  BindPoint<StorageBuffer> update() {
+    auto slot = engine.getFrameSlot();
+    if (dirtyStart[slot] != dirtyEnd[slot]) {
+      auto bytes = reinterpret_cast<const uint8_t *>(&values);
+      engine.writeStorageBuffer(buffers[slot], bytes + dirtyStart[slot],
+                                dirtyStart[slot],
+                                dirtyEnd[slot] - dirtyStart[slot]);
+      dirtyStart[slot] = dirtyEnd[slot] = 0;
+    }
+    return buffers[slot]->bindPoint;
+  }
+
+  // Copy of the frame being recorded, only up to date after update
+  BindPoint<StorageBuffer> getBindPoint() const {
+    return buffers[engine.getFrameSlot()]->bindPoint;
+  }
+};
+} // namespace val
@@ -0,0 +1,114 @@
+#include "pass_recorder.hpp"
+
+#include "system.hpp"
+
+namespace val {
+ReusablePass::ReusablePass(Engine &engine) {
+  for (size_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
+    secondaries.push_back(engine.allocateReusable());
+  }
+}
+
+void ReusablePass::invalidate() {
+  for (auto &slotRecorded : recorded) {
+    slotRecorded = false;
+  }
+}
+
+void PassRecorder::primary(Record record) {
+  steps.push_back({.primary = std::move(record)});
+}
+
+void PassRecorder::pass(std::vector<Texture *> framebuffers,
+                        Texture *depthBuffer, bool clearDepth, Size area,
+                        std::vector<Record> draws) {
+  steps.push_back({.framebuffers = std::move(framebuffers),
+                   .depthBuffer = depthBuffer,
+                   .clearDepth = clearDepth,
+                   .area = area,
+                   .draws = std::move(draws)});
+}
+
+void PassRecorder::pass(std::vector<Texture *> framebuffers,
+                        Texture *depthBuffer, bool clearDepth, Size area,
+                        ReusablePass &reusable, uint64_t key,
+                        SlotRecord draw) {
+  steps.push_back({.framebuffers = std::move(framebuffers),
+                   .depthBuffer = depthBuffer,
+                   .clearDepth = clearDepth,
+                   .area = area,
+                   .reusable = &reusable,
+                   .key = key,
+                   .reusableDraw = std::move(draw)});
+}
+
+void PassRecorder::recordReusable(Step &step,
+                                  const PassInheritance &inheritance) {
+  auto slot = engine.getFrameSlot();
+  auto &reusable = *step.reusable;
+  auto secondary = *reusable.secondaries[slot];
+  step.secondaries = {secondary};
+
+  // The attachments are inherited by format, any target of the same formats
+  // can reuse the commands
+  auto key = hash::fnv1a(step.key);
+  for (auto format : inheritance.colorFormats) {
+    key = hash::fnv1a(format, key);
+  }
+  key = hash::fnv1a(inheritance.depthFormat, key);
+  key = hash::fnv1a(inheritance.samples, key);
+  key = hash::fnv1a(step.area, key);
+  if (reusable.recorded[slot] && reusable.keys[slot] == key) {
+    return;
+  }
+
+  // The fence of the frame that last executed it has been waited on
+  auto cmd = engine.beginReusable(secondary, inheritance);
+  step.reusableDraw(cmd, slot);
+  cmd.end();
+  reusable.keys[slot] = key;
+  reusable.recorded[slot] = true;
+}
+
+void PassRecorder::record(CommandBuffer &primary) {
+  jobs::Counter recording;
+  for (auto &step : steps) {
+    if (step.primary) {
+      continue;
+    }
+    auto inheritance = PassInheritance::fromAttachments(step.framebuffers,
+                                                        step.depthBuffer);
+    if (step.reusable) {
+      recordReusable(step, inheritance);
+      continue;
+    }
+    step.secondaries.resize(step.draws.size());
+    for (size_t i = 0; i < step.draws.size(); i++) {
+      jobSystem.run(
+          [this, &step, inheritance, i] {
+            // Workers are 1 and up, the waiting thread records on pool 0
+            auto cmd = engine.beginSecondary(jobSystem.getCurrentWorker() + 1,
+                                             inheritance);
+            step.draws[i](cmd);
+            cmd.end();
+            step.secondaries[i] = cmd.cmd;
+          },
+          &recording);
+    }
+  }
+  // The calling thread records too while it waits
+  jobSystem.wait(recording);
+
+  for (auto &step : steps) {
+    if (step.primary) {
+      step.primary(primary);
+      continue;
+    }
+    primary.beginSecondaryPass(step.framebuffers, step.depthBuffer,
+                               step.clearDepth, step.area);
+    primary.executeSecondaries(step.secondaries);
+    primary.endPass();
+  }
+  steps.clear();
+}
+} // namespace val
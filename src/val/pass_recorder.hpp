@@ -0,0 +1,96 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "../foundation/jobs.hpp"
+#include "commands.hpp"
+
+namespace val {
+class Engine;
+
+// Pass contents recorded once per frame slot and executed again every time
+// the slot comes around. Whatever changes between frames has to be read from
+// buffers written for the slot, the commands are only recorded again when
+// the key passed to PassRecorder::pass changes or after invalidate
+class ReusablePass {
+  friend class PassRecorder;
+
+private:
+  std::vector<vk::raii::CommandBuffer> secondaries;
+  uint64_t keys[FRAMES_IN_FLIGHT]{};
+  bool recorded[FRAMES_IN_FLIGHT]{};
+
+public:
+  ReusablePass(Engine &engine);
+
+  // Call when something the commands use is destroyed, such as a pipeline
+  void invalidate();
+};
+
+// Records a sequence of passes with their contents in secondary command
+// buffers. Passes and the primary commands between them are queued, record
+// then records every queued draw on the job system and stitches the
+// secondaries into the primary in the order everything was queued.
+//
+// Queued functions run after the call that queued them returns, they must
+// capture what they use by value or outlive record.
+class PassRecorder {
+public:
+  using Record = std::function<void(CommandBuffer &cmd)>;
+  // Records the contents for one frame slot
+  using SlotRecord = std::function<void(CommandBuffer &cmd, uint32_t slot)>;
+
+private:
+  struct Step {
+    // Either primary commands or a pass
+    Record primary;
+
+    std::vector<Texture *> framebuffers;
+    Texture *depthBuffer{};
+    bool clearDepth{};
+    Size area;
+    // One secondary each, executed in order
+    std::vector<Record> draws;
+    std::vector<vk::CommandBuffer> secondaries;
+    // Replaces draws, already recorded unless stale
+    ReusablePass *reusable{};
+    uint64_t key{};
+    SlotRecord reusableDraw;
+  };
+
+  void recordReusable(Step &step, const PassInheritance &inheritance);
+
+  Engine &engine;
+  jobs::JobSystem &jobSystem;
+  std::vector<Step> steps;
+
+public:
+  PassRecorder(Engine &engine, jobs::JobSystem &jobSystem)
+      : engine(engine), jobSystem(jobSystem) {}
+
+  // Recorded into the primary between the passes queued around it
+  void primary(Record record);
+
+  // A pass as CommandBuffer::beginPass begins it, every draw function
+  // records into its own secondary so a large pass can be split
+  void pass(std::vector<Texture *> framebuffers, Texture *depthBuffer,
+            bool clearDepth, Size area, std::vector<Record> draws);
+  void pass(std::vector<Texture *> framebuffers, Texture *depthBuffer,
+            bool clearDepth, Size area, Record draw) {
+    pass(std::move(framebuffers), depthBuffer, clearDepth, area,
+         std::vector<Record>{std::move(draw)});
+  }
+
+  // Executes the contents reusable recorded for the current frame slot,
+  // draw only runs when they are stale. The key identifies everything the
+  // commands depend on besides the attachments and area, usually the
+  // pipeline
+  void pass(std::vector<Texture *> framebuffers, Texture *depthBuffer,
+            bool clearDepth, Size area, ReusablePass &reusable, uint64_t key,
+            SlotRecord draw);
+
+  // Records everything queued since the last call into primary
+  void record(CommandBuffer &primary);
+};
+} // namespace val
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "system.hpp"
+
+namespace val {
+
+// One T per frame in flight, such as a buffer the GPU writes every frame.
+// Each frame only touches its own copy, so the next frame can start writing
+// while the previous one is still reading without a barrier between them.
+// get returns the copy of the frame being recorded, slot specific recording
+// such as ReusablePass contents passes its slot to operator[]
+template <typename T> class PerFrame {
+private:
+  Engine &engine;
+  T items[FRAMES_IN_FLIGHT];
+
+public:
+  // create is called with every slot in order
+  template <typename Create>
+  PerFrame(Engine &engine, Create create) : engine(engine) {
+    for (uint32_t slot = 0; slot < FRAMES_IN_FLIGHT; slot++) {
+      items[slot] = create(slot);
+    }
+  }
+
+  T &get() { return items[engine.getFrameSlot()]; }
+  const T &get() const { return items[engine.getFrameSlot()]; }
+  T &operator[](uint32_t slot) { return items[slot]; }
+
+  T *begin() { return items; }
+  T *end() { return items + FRAMES_IN_FLIGHT; }
+};
+} // namespace val
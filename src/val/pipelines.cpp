@@ -15,10 +15,10 @@ PipelineBuilder::PipelineBuilder(Engine &engine) : engine(engine) {
   disableDepthTest();
 }
 
-PipelineBuilder &PipelineBuilder::addStage(const std::span<uint8_t> shaderData,
+PipelineBuilder &PipelineBuilder::addStage(std::span<const uint8_t> shaderData,
                                            ShaderStage stage) {
   vk::ShaderModuleCreateInfo moduleCreate;
-  moduleCreate.pCode = (uint32_t *)shaderData.data();
+  moduleCreate.pCode = (const uint32_t *)shaderData.data();
   moduleCreate.codeSize = shaderData.size();
   rasterizer.lineWidth = 1.f;
 
@@ -84,6 +84,16 @@ PipelineBuilder &PipelineBuilder::disableMultisampling() {
   return *this;
 }
 
+PipelineBuilder &PipelineBuilder::setSampleShading(uint32_t samples) {
+  multisample.sampleShadingEnable = true;
+  multisample.rasterizationSamples = vk::SampleCountFlagBits(samples);
+  multisample.minSampleShading = 1.0f;
+  multisample.pSampleMask = nullptr;
+  multisample.alphaToCoverageEnable = false;
+  multisample.alphaToOneEnable = false;
+  return *this;
+}
+
 PipelineBuilder &PipelineBuilder::disableDepthTest() {
   depthStencil.depthTestEnable = false;
   depthStencil.depthWriteEnable = false;
@@ -117,6 +127,17 @@ PipelineBuilder &PipelineBuilder::depthTestRead() {
   return *this;
 }
 
+PipelineBuilder &PipelineBuilder::depthTestEqual() {
+  depthStencil.depthTestEnable = true;
+  depthStencil.depthWriteEnable = false;
+  depthStencil.depthCompareOp = vk::CompareOp::eEqual;
+  depthStencil.depthBoundsTestEnable = false;
+  depthStencil.stencilTestEnable = false;
+  depthStencil.minDepthBounds = 0.f;
+  depthStencil.maxDepthBounds = 1.f;
+  return *this;
+}
+
 PipelineBuilder &PipelineBuilder::setTessellation(uint32_t controlPoints) {
   tessellation.patchControlPoints = controlPoints;
   return *this;
@@ -143,9 +164,14 @@ GraphicsPipeline PipelineBuilder::build() {
   renderInfo.colorAttachmentCount = colorAttachmentFormats.size();
   renderInfo.pColorAttachmentFormats = colorAttachmentFormats.data();
 
+  auto specializedStages = stages;
+  for (auto &stage : specializedStages) {
+    stage.pSpecializationInfo = specialization.getInfo();
+  }
+
   vk::GraphicsPipelineCreateInfo createInfo;
-  createInfo.stageCount = stages.size();
-  createInfo.pStages = stages.data();
+  createInfo.stageCount = specializedStages.size();
+  createInfo.pStages = specializedStages.data();
   createInfo.pVertexInputState = &vertexInput;
   createInfo.pInputAssemblyState = &assembly;
   createInfo.pViewportState = &viewport;
@@ -166,9 +192,9 @@ GraphicsPipeline PipelineBuilder::build() {
   return GraphicsPipeline(engine.device, createInfo, layoutInfo);
 }
 ComputePipelineBuilder &
-ComputePipelineBuilder::setShader(const std::span<uint8_t> shaderData) {
+ComputePipelineBuilder::setShader(std::span<const uint8_t> shaderData) {
   vk::ShaderModuleCreateInfo moduleCreate;
-  moduleCreate.pCode = (uint32_t *)shaderData.data();
+  moduleCreate.pCode = (const uint32_t *)shaderData.data();
   moduleCreate.codeSize = shaderData.size();
 
   shaderModule = engine.device.createShaderModule(moduleCreate);
@@ -190,7 +216,18 @@ ComputePipeline ComputePipelineBuilder::build() {
 
   vk::ComputePipelineCreateInfo computeCreateInfo;
   computeCreateInfo.stage = stage;
+  computeCreateInfo.stage.pSpecializationInfo = specialization.getInfo();
 
   return ComputePipeline(engine.device, computeCreateInfo, layoutInfo);
 }
-} // namespace val
\ No newline at end of file
+
+void Engine::destroyPipeline(GraphicsPipeline &pipeline) {
+  deletionQueue.pipelines.push_back(std::move(pipeline.pipeline));
+  deletionQueue.pipelineLayouts.push_back(std::move(pipeline.layout));
+}
+
+void Engine::destroyPipeline(ComputePipeline &pipeline) {
+  deletionQueue.pipelines.push_back(std::move(pipeline.pipeline));
+  deletionQueue.pipelineLayouts.push_back(std::move(pipeline.layout));
+}
+} // namespace val
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstring>
+
 #include "gpu_resources.hpp"
 #include "system.hpp"
 #include "types.hpp"
@@ -7,6 +9,7 @@
 namespace val {
 class GraphicsPipeline {
   friend class CommandBuffer;
+  friend class Engine;
   friend class PipelineBuilder;
 
 private:
@@ -24,10 +27,15 @@ private:
 
 public:
   GraphicsPipeline() = default;
+
+  // Identifies the pipeline while it is alive, such as in the key of a
+  // ReusablePass
+  vk::Pipeline getHandle() const { return *pipeline; }
 };
 
 class ComputePipeline {
   friend class CommandBuffer;
+  friend class Engine;
   friend class ComputePipelineBuilder;
 
 private:
@@ -47,23 +55,74 @@ public:
   ComputePipeline() = default;
 };
 
+// Values for constant_id declarations, shared by every stage of a pipeline.
+// GLSL bools are 32 bit, pass them as VkBool32
+class SpecializationConstants {
+private:
+  std::vector<vk::SpecializationMapEntry> entries;
+  std::vector<uint8_t> data;
+  vk::SpecializationInfo info;
+
+public:
+  template <typename T> void set(uint32_t id, const T &value) {
+    static_assert(sizeof(T) == 4, "Specialization constants are 32 bit");
+    for (auto &entry : entries) {
+      if (entry.constantID == id) {
+        memcpy(data.data() + entry.offset, &value, sizeof(T));
+        return;
+      }
+    }
+    entries.push_back({id, (uint32_t)data.size(), sizeof(T)});
+    data.resize(data.size() + sizeof(T));
+    memcpy(data.data() + entries.back().offset, &value, sizeof(T));
+  }
+
+  void clear() {
+    entries.clear();
+    data.clear();
+  }
+
+  // Null without constants, valid until the next change
+  const vk::SpecializationInfo *getInfo() {
+    if (entries.empty()) {
+      return nullptr;
+    }
+    info.mapEntryCount = entries.size();
+    info.pMapEntries = entries.data();
+    info.dataSize = data.size();
+    info.pData = data.data();
+    return &info;
+  }
+};
+
 class ComputePipelineBuilder {
 private:
   Engine &engine;
   vk::PushConstantRange pushConstant;
+  SpecializationConstants specialization;
 
   vk::PipelineShaderStageCreateInfo stage;
   vk::raii::ShaderModule shaderModule{nullptr};
 
 public:
   ComputePipelineBuilder(Engine &engine) : engine(engine) {}
-  ComputePipelineBuilder &setShader(const std::span<uint8_t> shaderData);
+  ComputePipelineBuilder &setShader(std::span<const uint8_t> shaderData);
   template <typename T> ComputePipelineBuilder &setPushConstant() {
     pushConstant.size = sizeof(T);
     pushConstant.offset = 0;
 
     return *this;
   }
+  template <typename T>
+  ComputePipelineBuilder &setSpecializationConstant(uint32_t id,
+                                                    const T &value) {
+    specialization.set(id, value);
+    return *this;
+  }
+  ComputePipelineBuilder &clearSpecializationConstants() {
+    specialization.clear();
+    return *this;
+  }
   ComputePipeline build();
 };
 
@@ -83,6 +142,7 @@ private:
   std::vector<vk::VertexInputAttributeDescription> attributes;
   std::vector<vk::raii::ShaderModule> modules;
   std::vector<vk::PipelineShaderStageCreateInfo> stages;
+  SpecializationConstants specialization;
 
   vk::PipelineVertexInputStateCreateInfo vertexInput;
   vk::PipelineInputAssemblyStateCreateInfo assembly;
@@ -105,13 +165,23 @@ public:
     return *this;
   }
 
-  PipelineBuilder &addStage(const std::span<uint8_t> shaderData,
+  PipelineBuilder &addStage(std::span<const uint8_t> shaderData,
                             ShaderStage stage);
   PipelineBuilder &clearStages() {
     stages.clear();
     modules.clear();
     return *this;
   }
+  // Applies to every stage, ids a stage does not declare are ignored
+  template <typename T>
+  PipelineBuilder &setSpecializationConstant(uint32_t id, const T &value) {
+    specialization.set(id, value);
+    return *this;
+  }
+  PipelineBuilder &clearSpecializationConstants() {
+    specialization.clear();
+    return *this;
+  }
   PipelineBuilder &setVertexStride(uint32_t stride) {
     this->stride = stride;
     return *this;
@@ -147,10 +217,16 @@ public:
   }
 
   PipelineBuilder &disableMultisampling();
+  // Rasterizes with the given sample count and runs the fragment shader once
+  // per sample, requires the sampleRateShading feature
+  PipelineBuilder &setSampleShading(uint32_t samples);
 
   PipelineBuilder &disableDepthTest();
   PipelineBuilder &depthTestRead();
   PipelineBuilder &depthTestReadWrite();
+  // Only passes fragments at exactly the depth already in the buffer, for
+  // shading after a depth pre-pass
+  PipelineBuilder &depthTestEqual();
 
   PipelineBuilder &setTessellation(uint32_t controlPoints);
 
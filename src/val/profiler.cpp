@@ -0,0 +1,194 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+
+namespace val {
+constexpr vk::QueryPipelineStatisticFlags STATISTICS_FLAGS =
+    vk::QueryPipelineStatisticFlagBits::eClippingPrimitives |
+    vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations |
+    vk::QueryPipelineStatisticFlagBits::eTessellationControlShaderPatches |
+    vk::QueryPipelineStatisticFlagBits::
+        eTessellationEvaluationShaderInvocations |
+    vk::QueryPipelineStatisticFlagBits::eComputeShaderInvocations;
+
+// Number of values written per statistics query, one per bit in
+// STATISTICS_FLAGS ordered from lowest to highest bit
+constexpr uint32_t STATISTICS_VALUES = 5;
+
+void GpuProfiler::init(const vk::raii::Device &device,
+                       const vk::PhysicalDeviceProperties &properties,
+                       bool enableStatistics) {
+  timestampsSupported = properties.limits.timestampComputeAndGraphics &&
+                        properties.limits.timestampPeriod > 0;
+  statisticsSupported = enableStatistics;
+  timestampPeriod = properties.limits.timestampPeriod;
+
+  for (auto &frame : frames) {
+    if (timestampsSupported) {
+      vk::QueryPoolCreateInfo createInfo;
+      createInfo.queryType = vk::QueryType::eTimestamp;
+      createInfo.queryCount = MAX_SCOPES * 2;
+      frame.timestamps = device.createQueryPool(createInfo);
+    }
+
+    if (statisticsSupported) {
+      vk::QueryPoolCreateInfo createInfo;
+      createInfo.queryType = vk::QueryType::ePipelineStatistics;
+      createInfo.queryCount = MAX_STATISTICS;
+      createInfo.pipelineStatistics = STATISTICS_FLAGS;
+      frame.statistics = device.createQueryPool(createInfo);
+    }
+  }
+}
+
+FrameProfile GpuProfiler::readResults(FrameQueries &queries) {
+  FrameProfile profile;
+  profile.frame = queries.frame;
+
+  if (timestampsSupported && !queries.scopeNames.empty()) {
+    auto count = (uint32_t)queries.scopeNames.size() * 2;
+    auto [result, values] = queries.timestamps.getResults<uint64_t>(
+        0, count, count * sizeof(uint64_t), sizeof(uint64_t),
+        vk::QueryResultFlagBits::e64);
+    if (result != vk::Result::eSuccess) {
+      return {};
+    }
+
+    for (size_t i = 0; i < queries.scopeNames.size(); i++) {
+      auto ticks = values[i * 2 + 1] - values[i * 2];
+      profile.scopes.push_back(
+          {.name = queries.scopeNames[i],
+           .gpuMs = ticks * timestampPeriod / 1000000.0});
+    }
+    // Scope 0 always wraps the whole frame
+    profile.gpuFrameMs = profile.scopes[0].gpuMs;
+  }
+
+  if (statisticsSupported && !queries.statisticsNames.empty()) {
+    auto count = (uint32_t)queries.statisticsNames.size();
+    auto [result, values] = queries.statistics.getResults<uint64_t>(
+        0, count, count * STATISTICS_VALUES * sizeof(uint64_t),
+        STATISTICS_VALUES * sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    if (result != vk::Result::eSuccess) {
+      return {};
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      auto *v = &values[i * STATISTICS_VALUES];
+      profile.statistics.push_back({.name = queries.statisticsNames[i],
+                                    .clippingPrimitives = v[0],
+                                    .fragmentInvocations = v[1],
+                                    .tessellationPatches = v[2],
+                                    .tessellationInvocations = v[3],
+                                    .computeInvocations = v[4]});
+    }
+  }
+
+  profile.valid = true;
+  return profile;
+}
+
+std::vector<FrameProfile> GpuProfiler::readPending() {
+  std::vector<FrameProfile> profiles;
+  for (auto &queries : frames) {
+    if (!queries.submitted) {
+      continue;
+    }
+    queries.submitted = false;
+    auto profile = readResults(queries);
+    if (profile.valid) {
+      profiles.push_back(std::move(profile));
+    }
+  }
+  std::sort(profiles.begin(), profiles.end(),
+            [](const FrameProfile &a, const FrameProfile &b) {
+              return a.frame < b.frame;
+            });
+  if (!profiles.empty()) {
+    lastProfile = profiles.back();
+  }
+  return profiles;
+}
+
+void GpuProfiler::beginFrame(vk::CommandBuffer cmd, uint32_t slot,
+                             uint32_t frame) {
+  current = &frames[slot];
+
+  // The fence of this slot has been waited on, so its queries are available
+  if (current->submitted) {
+    auto profile = readResults(*current);
+    if (profile.valid) {
+      lastProfile = std::move(profile);
+    }
+  }
+
+  current->scopeNames.clear();
+  current->openScopes.clear();
+  current->statisticsNames.clear();
+  current->statisticsOpen = false;
+  current->frame = frame;
+  current->submitted = false;
+
+  if (timestampsSupported) {
+    cmd.resetQueryPool(*current->timestamps, 0, MAX_SCOPES * 2);
+  }
+  if (statisticsSupported) {
+    cmd.resetQueryPool(*current->statistics, 0, MAX_STATISTICS);
+  }
+
+  beginScope(cmd, "frame");
+}
+
+void GpuProfiler::endFrame(vk::CommandBuffer cmd) {
+  while (!current->openScopes.empty()) {
+    endScope(cmd);
+  }
+  current->submitted = true;
+}
+
+void GpuProfiler::beginScope(vk::CommandBuffer cmd, const char *name) {
+  if (!timestampsSupported || current->scopeNames.size() >= MAX_SCOPES) {
+    return;
+  }
+  auto index = (uint32_t)current->scopeNames.size();
+  current->scopeNames.push_back(name);
+  current->openScopes.push_back(index);
+  cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands,
+                      *current->timestamps, index * 2);
+}
+
+void GpuProfiler::endScope(vk::CommandBuffer cmd) {
+  if (!timestampsSupported || current->openScopes.empty()) {
+    return;
+  }
+  auto index = current->openScopes.back();
+  current->openScopes.pop_back();
+  cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands,
+                      *current->timestamps, index * 2 + 1);
+}
+
+vk::QueryPipelineStatisticFlags GpuProfiler::getStatisticsFlags() const {
+  return statisticsSupported ? STATISTICS_FLAGS
+                             : vk::QueryPipelineStatisticFlags{};
+}
+
+void GpuProfiler::beginStatistics(vk::CommandBuffer cmd, const char *name) {
+  if (!statisticsSupported || current->statisticsOpen ||
+      current->statisticsNames.size() >= MAX_STATISTICS) {
+    return;
+  }
+  current->statisticsNames.push_back(name);
+  current->statisticsOpen = true;
+  cmd.beginQuery(*current->statistics,
+                 (uint32_t)current->statisticsNames.size() - 1, {});
+}
+
+void GpuProfiler::endStatistics(vk::CommandBuffer cmd) {
+  if (!statisticsSupported || !current->statisticsOpen) {
+    return;
+  }
+  current->statisticsOpen = false;
+  cmd.endQuery(*current->statistics,
+               (uint32_t)current->statisticsNames.size() - 1);
+}
+} // namespace val
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "types.hpp"
+
+namespace val {
+struct ProfileScope {
+  std::string name;
+  double gpuMs{};
+};
+
+struct PipelineStatistics {
+  std::string name;
+  uint64_t clippingPrimitives{};
+  uint64_t fragmentInvocations{};
+  uint64_t tessellationPatches{};
+  uint64_t tessellationInvocations{};
+  uint64_t computeInvocations{};
+};
+
+struct FrameProfile {
+  // Frame counter value of the frame these results were recorded on
+  uint32_t frame{};
+  bool valid{};
+  double gpuFrameMs{};
+  std::vector<ProfileScope> scopes;
+  std::vector<PipelineStatistics> statistics;
+};
+
+// Collects GPU timestamps and pipeline statistics for each frame in flight,
+// results are read back once the frame fence has been waited on, so they are
+// FRAMES_IN_FLIGHT frames behind the frame being recorded
+class GpuProfiler {
+  friend class Engine;
+  friend class CommandBuffer;
+
+private:
+  static constexpr uint32_t MAX_SCOPES = 32;
+  static constexpr uint32_t MAX_STATISTICS = 8;
+
+  struct FrameQueries {
+    vk::raii::QueryPool timestamps{nullptr};
+    vk::raii::QueryPool statistics{nullptr};
+
+    std::vector<std::string> scopeNames;
+    std::vector<uint32_t> openScopes;
+    std::vector<std::string> statisticsNames;
+    bool statisticsOpen{};
+
+    uint32_t frame{};
+    bool submitted{};
+  };
+
+  bool timestampsSupported{};
+  bool statisticsSupported{};
+  double timestampPeriod{};
+
+  FrameQueries frames[FRAMES_IN_FLIGHT];
+  FrameQueries *current{};
+
+  FrameProfile lastProfile;
+
+  void init(const vk::raii::Device &device,
+            const vk::PhysicalDeviceProperties &properties,
+            bool enableStatistics);
+
+  void beginFrame(vk::CommandBuffer cmd, uint32_t slot, uint32_t frame);
+  void endFrame(vk::CommandBuffer cmd);
+
+  void beginScope(vk::CommandBuffer cmd, const char *name);
+  void endScope(vk::CommandBuffer cmd);
+
+  void beginStatistics(vk::CommandBuffer cmd, const char *name);
+  void endStatistics(vk::CommandBuffer cmd);
+
+  // Invalid when the results are not available
+  FrameProfile readResults(FrameQueries &queries);
+
+public:
+  const FrameProfile &getLastFrame() const { return lastProfile; }
+  // Results of the submitted frames that were not read yet, oldest first.
+  // Only valid once the device is idle
+  std::vector<FrameProfile> readPending();
+  bool hasStatistics() const { return statisticsSupported; }
+  // Counters of the statistics queries, empty when they are not supported
+  vk::QueryPipelineStatisticFlags getStatisticsFlags() const;
+};
+} // namespace val
@@ -173,6 +173,12 @@ class Image : NoCopy {
         return *this;
     }
 
+    // Refers to an image owned elsewhere, it is not destroyed by free
+    void wrap(vk::Image external) {
+        free();
+        image = external;
+    }
+
     operator vk::Image() { return image; }
 };
 };  // namespace raii
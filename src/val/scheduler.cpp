@@ -0,0 +1,92 @@
+#include "scheduler.hpp"
+
+#include <cassert>
+
+#include "system.hpp"
+
+namespace val {
+// Weight of a new measurement in the slice cost average
+constexpr double COST_RESPONSE = 0.25;
+
+void GpuScheduler::submit(const std::string &name, uint32_t slices,
+                          RecordSlice record, Finish finish) {
+  assert(slices > 0);
+  // A started job only wrote slices its finish has not published yet
+  std::erase_if(jobs, [&](const Job &job) { return job.name == name; });
+  jobs.push_back({.name = name,
+                  .slices = slices,
+                  .record = std::move(record),
+                  .finish = std::move(finish)});
+}
+
+void GpuScheduler::learn(const FrameProfile &profile) {
+  if (!profile.valid || profile.frame == lastProfileFrame) {
+    return;
+  }
+  lastProfileFrame = profile.frame;
+
+  for (auto &entry : recorded) {
+    if (entry.frame != profile.frame || entry.slices == 0) {
+      continue;
+    }
+    for (auto &scope : profile.scopes) {
+      if (scope.name != entry.name) {
+        continue;
+      }
+      double ms = scope.gpuMs / entry.slices;
+      auto cost = sliceMs.find(entry.name);
+      if (cost == sliceMs.end()) {
+        sliceMs[entry.name] = ms;
+      } else {
+        cost->second += (ms - cost->second) * COST_RESPONSE;
+      }
+      break;
+    }
+  }
+
+  while (!recorded.empty() && recorded.front().frame <= profile.frame) {
+    recorded.pop_front();
+  }
+}
+
+void GpuScheduler::update(CommandBuffer &cmd) {
+  learn(engine.getGpuProfile());
+  if (jobs.empty()) {
+    return;
+  }
+
+  auto &job = jobs.front();
+  // Unmeasured jobs record a single slice until their cost is known
+  auto cost = sliceMs.find(job.name);
+  double estimateMs = cost != sliceMs.end() ? cost->second : budgetMs;
+
+  uint32_t count = 0;
+  cmd.beginProfile(job.name.c_str());
+  do {
+    job.record(cmd, job.nextSlice++);
+    count++;
+  } while (job.nextSlice < job.slices &&
+           (count + 1) * estimateMs <= budgetMs);
+  cmd.endProfile();
+
+  recorded.push_back(
+      {.frame = engine.getFrameNumber(), .name = job.name, .slices = count});
+  // Without timestamps the profiles never arrive
+  if (recorded.size() > MAX_RECORDED) {
+    recorded.pop_front();
+  }
+
+  if (job.nextSlice < job.slices) {
+    return;
+  }
+  if (job.finish) {
+    job.finish(cmd);
+  }
+  jobs.pop_front();
+}
+
+double GpuScheduler::getSliceMs(const std::string &name) const {
+  auto cost = sliceMs.find(name);
+  return cost != sliceMs.end() ? cost->second : 0;
+}
+} // namespace val
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#include "commands.hpp"
+#include "profiler.hpp"
+
+namespace val {
+class Engine;
+
+// Spreads expensive GPU work over several frames under a per frame GPU time
+// budget. A job is a fixed number of slices recorded in order, the cost of a
+// slice is learned from the profiler scope wrapped around every job's slices
+// in a frame. Jobs run one after the other and at least one slice is recorded
+// each frame, so work always progresses.
+//
+// Only one job records slices in a frame, so a job never starts in the frame
+// the previous one finished. With FRAMES_IN_FLIGHT frames this lets a finish
+// swap double buffered results and the next job write the retired buffer once
+// the GPU stopped reading it.
+class GpuScheduler {
+public:
+  using RecordSlice = std::function<void(CommandBuffer &cmd, uint32_t slice)>;
+  using Finish = std::function<void(CommandBuffer &cmd)>;
+
+private:
+  struct Job {
+    std::string name;
+    uint32_t slices{};
+    uint32_t nextSlice{};
+    RecordSlice record;
+    Finish finish;
+  };
+
+  // Slices of a job recorded in a frame, matched with that frame's profile
+  struct RecordedSlices {
+    uint32_t frame{};
+    std::string name;
+    uint32_t slices{};
+  };
+
+  static constexpr size_t MAX_RECORDED = 16;
+
+  Engine &engine;
+  std::deque<Job> jobs;
+  std::deque<RecordedSlices> recorded;
+  std::unordered_map<std::string, double> sliceMs;
+  uint32_t lastProfileFrame = UINT32_MAX;
+
+  void learn(const FrameProfile &profile);
+
+public:
+  // GPU time per frame the slices may use
+  float budgetMs = 0.5f;
+
+  GpuScheduler(Engine &engine) : engine(engine) {}
+
+  // A job with the same name is cancelled, also when it has started: its
+  // remaining slices are dropped and its finish is never called. The new
+  // job runs after the current one
+  void submit(const std::string &name, uint32_t slices, RecordSlice record,
+              Finish finish = {});
+
+  // Records this frame's slices, call once per frame
+  void update(CommandBuffer &cmd);
+
+  bool isBusy() const { return !jobs.empty(); }
+  // Measured GPU time of one slice of the job, 0 until a frame is measured
+  double getSliceMs(const std::string &name) const;
+};
+} // namespace val
@@ -1,6 +1,8 @@
 #include "system.hpp"
 
 #include <VkBootstrap.h>
+
+#include <algorithm>
 namespace val {
 void Engine::initVulkan() {
   vkb::InstanceBuilder builder;
@@ -8,6 +10,7 @@ void Engine::initVulkan() {
                       .request_validation_layers(true)
                       .use_default_debug_messenger()
                       .require_api_version(1, 3, 0)
+                      .set_headless(initConfig.headless)
                       .build();
 
   vkb::Instance vkb_inst = inst_ret.value();
@@ -15,8 +18,11 @@ void Engine::initVulkan() {
   debug_messenger =
       vk::raii::DebugUtilsMessengerEXT(instance, vkb_inst.debug_messenger);
 
-  auto surface = presentation->getSurface(*instance);
-  this->surface = vk::raii::SurfaceKHR(instance, surface);
+  VkSurfaceKHR surface{};
+  if (!initConfig.headless) {
+    surface = presentation->getSurface(*instance);
+    this->surface = vk::raii::SurfaceKHR(instance, surface);
+  }
 
   vk::PhysicalDeviceVulkan13Features features = initConfig.features;
   features.dynamicRendering = true;
@@ -33,17 +39,28 @@ void Engine::initVulkan() {
   features12.descriptorBindingUniformBufferUpdateAfterBind = true;
   features12.shaderStorageBufferArrayNonUniformIndexing = true;
   features12.descriptorBindingStorageBufferUpdateAfterBind = true;
+  features12.descriptorBindingStorageImageUpdateAfterBind = true;
 
   vk::PhysicalDeviceFeatures features10 = initConfig.features10;
+  // Storage images are declared without a format in shaders
+  features10.shaderStorageImageWriteWithoutFormat = true;
+  // Statistics scopes may enclose passes recorded into secondary command
+  // buffers
+  if (features10.pipelineStatisticsQuery) {
+    features10.inheritedQueries = true;
+  }
 
   vkb::PhysicalDeviceSelector selector{vkb_inst};
-  vkb::PhysicalDevice physicalDevice = selector.set_minimum_version(1, 3)
-                                           .set_required_features_13(features)
-                                           .set_required_features_12(features12)
-                                           .set_required_features(features10)
-                                           .set_surface(surface)
-                                           .select()
-                                           .value();
+  selector.set_minimum_version(1, 3)
+      .set_required_features_13(features)
+      .set_required_features_12(features12)
+      .set_required_features(features10);
+  if (initConfig.headless) {
+    selector.require_present(false);
+  } else {
+    selector.set_surface(surface);
+  }
+  vkb::PhysicalDevice physicalDevice = selector.select().value();
 
   vkb::DeviceBuilder deviceBuilder{physicalDevice};
 
@@ -54,13 +71,14 @@ void Engine::initVulkan() {
   device = vk::raii::Device(chosenGPU, vkbDevice.device);
 
   graphicsQueue = vkbDevice.get_queue(vkb::QueueType::graphics).value();
-  presentQueue = vkbDevice.get_queue(vkb::QueueType::present).value();
-
   graphicsQueueFamily =
       vkbDevice.get_queue_index(vkb::QueueType::graphics).value();
 
-  presentQueueFamily =
-      vkbDevice.get_queue_index(vkb::QueueType::present).value();
+  if (!initConfig.headless) {
+    presentQueue = vkbDevice.get_queue(vkb::QueueType::present).value();
+    presentQueueFamily =
+        vkbDevice.get_queue_index(vkb::QueueType::present).value();
+  }
 
   VmaAllocatorCreateInfo allocatorInfo = {};
   allocatorInfo.physicalDevice = *chosenGPU;
@@ -74,23 +92,33 @@ void Engine::initVulkan() {
 }
 
 void Engine::reloadSwapchain() {
+  swapchain.targets.clear();
   swapchain.swapchain = vk::raii::SwapchainKHR(nullptr);
   swapchain.images.clear();
   swapchain.imageViews.clear();
   auto vkbSwapchain =
       vkb::SwapchainBuilder(*chosenGPU, *device, *surface)
           .set_desired_format(VkSurfaceFormatKHR{
-              .format = VK_FORMAT_B8G8R8A8_SRGB,
+              .format = (VkFormat)swapchain.format,
               .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR})
           .set_desired_present_mode((VkPresentModeKHR)initConfig.presentation)
           .set_desired_extent(windowSize.w, windowSize.h)
-          .add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+          .add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                                 VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)
           .build()
           .value();
 
   windowSize.w = vkbSwapchain.extent.width;
   windowSize.h = vkbSwapchain.extent.height;
 
+  // The desired format is only a preference, the post process writes linear
+  // colour so only sRGB formats can be its target
+  swapchain.format = (TextureFormat)vkbSwapchain.image_format;
+  if (swapchain.format != TextureFormat::BGRA8 &&
+      swapchain.format != TextureFormat::RGBA8) {
+    initConfig.renderToSwapchain = false;
+  }
+
   swapchain.swapchain = vk::raii::SwapchainKHR(device, vkbSwapchain.swapchain);
 
   swapchain.images.reserve(vkbSwapchain.image_count);
@@ -103,6 +131,83 @@ void Engine::reloadSwapchain() {
     swapchain.images.push_back(images[i]);
     swapchain.imageViews.push_back(vk::raii::ImageView(device, imageViews[i]));
   }
+
+  initSwapchainTargets();
+}
+
+void Engine::initSwapchainTargets() {
+  swapchain.targets.clear();
+  if (!initConfig.renderToSwapchain) {
+    return;
+  }
+
+  swapchain.targets.resize(swapchain.images.size());
+  for (size_t i = 0; i < swapchain.images.size(); i++) {
+    auto &target = swapchain.targets[i];
+    target.image.wrap(swapchain.images[i]);
+    target.size = windowSize;
+    target.format = swapchain.format;
+    target.mipLevels = 1;
+    target.layers = 1;
+
+    vk::ImageViewCreateInfo viewCreateInfo{};
+    viewCreateInfo.image = swapchain.images[i];
+    viewCreateInfo.format = vk::Format(swapchain.format);
+    viewCreateInfo.viewType = vk::ImageViewType::e2D;
+    viewCreateInfo.subresourceRange.aspectMask =
+        vk::ImageAspectFlagBits::eColor;
+    viewCreateInfo.subresourceRange.layerCount = 1;
+    viewCreateInfo.subresourceRange.levelCount = 1;
+    target.imageView = device.createImageView(viewCreateInfo);
+  }
+}
+
+void Engine::initHeadlessImages() {
+  swapchain.images.clear();
+  swapchain.imageViews.clear();
+  swapchain.headlessImages.clear();
+
+  windowSize = initConfig.headlessSize;
+
+  VkImageCreateInfo imageCreateInfo = {.sType =
+                                           VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+  imageCreateInfo.format = (VkFormat)swapchain.format;
+  imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageCreateInfo.extent = {
+      .width = windowSize.w, .height = windowSize.h, .depth = 1};
+  imageCreateInfo.mipLevels = 1;
+  imageCreateInfo.arrayLayers = 1;
+  imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                          VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                          VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+  VmaAllocationCreateInfo vmaAlloc = {.usage = VMA_MEMORY_USAGE_GPU_ONLY};
+
+  // One image per frame in flight, so a frame never renders into an image
+  // that the previous one is still writing
+  swapchain.images.reserve(FRAMES_IN_FLIGHT);
+  swapchain.imageViews.reserve(FRAMES_IN_FLIGHT);
+  swapchain.headlessImages.reserve(FRAMES_IN_FLIGHT);
+  for (size_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
+    auto &image = swapchain.headlessImages.emplace_back(vma, imageCreateInfo,
+                                                        vmaAlloc);
+
+    vk::ImageViewCreateInfo viewCreateInfo{};
+    viewCreateInfo.image = image;
+    viewCreateInfo.format = vk::Format(swapchain.format);
+    viewCreateInfo.viewType = vk::ImageViewType::e2D;
+    viewCreateInfo.subresourceRange.aspectMask =
+        vk::ImageAspectFlagBits::eColor;
+    viewCreateInfo.subresourceRange.layerCount = 1;
+    viewCreateInfo.subresourceRange.levelCount = 1;
+
+    swapchain.images.push_back(image);
+    swapchain.imageViews.push_back(device.createImageView(viewCreateInfo));
+  }
+
+  initSwapchainTargets();
 }
 
 void Engine::initFrameData() {
@@ -124,6 +229,15 @@ void Engine::initFrameData() {
     frame.commandBuffer =
         std::move(device.allocateCommandBuffers(cmdAllocInfo)[0]);
 
+    // Reset as a whole at the start of the frame
+    vk::CommandPoolCreateInfo threadPoolInfo{};
+    threadPoolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+    threadPoolInfo.queueFamilyIndex = graphicsQueueFamily;
+    frame.threads.resize(std::max(initConfig.recordingThreads, 1u));
+    for (auto &thread : frame.threads) {
+      thread.pool = vk::raii::CommandPool(device, threadPoolInfo);
+    }
+
     vk::FenceCreateInfo fenceCreate;
     fenceCreate.flags = vk::FenceCreateFlagBits::eSignaled;
     frame.renderFence = device.createFence(fenceCreate);
@@ -132,9 +246,17 @@ void Engine::initFrameData() {
     frame.swapchainSemaphore = device.createSemaphore(semaphoreCreate);
     frame.renderSemaphore = device.createSemaphore(semaphoreCreate);
   }
+
+  vk::CommandPoolCreateInfo reusablePoolInfo{};
+  reusablePoolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+  reusablePoolInfo.queueFamilyIndex = graphicsQueueFamily;
+  reusablePool = vk::raii::CommandPool(device, reusablePoolInfo);
 }
 
 void Engine::regenerate() {
+  if (initConfig.headless) {
+    return;
+  }
   windowSize = presentation->getSize();
 
   reloadSwapchain();
@@ -143,17 +265,20 @@ void Engine::regenerate() {
 Texture *Engine::createTextureBase(Size size, uint32_t levels,
                                    TextureFormat format,
                                    TextureSampler sampling, uint32_t mipLevels,
-                                   VkImageUsageFlags usage, bool cubemap) {
+                                   VkImageUsageFlags usage, bool cubemap,
+                                   uint32_t samples) {
   assert(mipLevels > 0 && mipLevels <= 32);
   assert(levels >= 1);
 
   Texture *texture = texturePool.allocate();
+  allocationStats.textures++;
 
   texture->size = size;
   texture->format = format;
   texture->sampler = sampling;
   texture->mipLevels = mipLevels;
   texture->layers = levels;
+  texture->samples = samples;
 
   VkImageCreateInfo imagecreateInfo = {.sType =
                                            VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
@@ -163,7 +288,7 @@ Texture *Engine::createTextureBase(Size size, uint32_t levels,
   imagecreateInfo.extent = {.width = size.w, .height = size.h, .depth = 1};
   imagecreateInfo.mipLevels = mipLevels;
   imagecreateInfo.arrayLayers = cubemap ? 6 : levels;
-  imagecreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imagecreateInfo.samples = (VkSampleCountFlagBits)samples;
   imagecreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
   imagecreateInfo.usage = usage | VK_IMAGE_USAGE_SAMPLED_BIT |
                           VK_IMAGE_USAGE_TRANSFER_DST_BIT |
@@ -195,6 +320,21 @@ Texture *Engine::createTextureBase(Size size, uint32_t levels,
   texture->imageView = device.createImageView(viewCreateInfo);
 
   texture->bindPoint = bindings.bindTexture(*texture->imageView, sampling);
+  // Storage image views must only contain a single mip level
+  if ((usage & VK_IMAGE_USAGE_STORAGE_BIT) && mipLevels == 1) {
+    texture->storageBindPoint = bindings.bindStorageImage(*texture->imageView);
+    texture->storage = true;
+  } else if (usage & VK_IMAGE_USAGE_STORAGE_BIT) {
+    viewCreateInfo.viewType =
+        levels > 1 ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D;
+    viewCreateInfo.subresourceRange.levelCount = 1;
+    for (uint32_t level = 0; level < mipLevels; level++) {
+      viewCreateInfo.subresourceRange.baseMipLevel = level;
+      auto &view =
+          texture->mipViews.emplace_back(device.createImageView(viewCreateInfo));
+      texture->mipStorageBindPoints.push_back(bindings.bindStorageImage(*view));
+    }
+  }
 
   return texture;
 }
@@ -204,9 +344,15 @@ Engine::Engine(const EngineInitConfig &initConfig,
     : presentation(presentation) {
   this->initConfig = initConfig;
   initVulkan();
-  reloadSwapchain();
+  if (initConfig.headless) {
+    initHeadlessImages();
+  } else {
+    reloadSwapchain();
+  }
   initFrameData();
   bindings.init(device, physicalDeviceProperties);
+  profiler.init(device, physicalDeviceProperties,
+                initConfig.features10.pipelineStatisticsQuery);
 
   if (initConfig.useImGUI) {
     initImgui();
@@ -235,9 +381,13 @@ void Engine::initImgui() {
   imguiDescriptorPool = device.createDescriptorPool(poolCreate);
 
   ImGui::CreateContext();
-  presentation->initImgui();
+  if (presentation) {
+    presentation->initImgui();
+  }
 
-  VkFormat format = (VkFormat)TextureFormat::RGBA16;
+  VkFormat format = (VkFormat)(initConfig.renderToSwapchain
+                                    ? swapchain.format
+                                    : TextureFormat::RGBA16);
   ImGui_ImplVulkan_InitInfo init_info = {};
   init_info.Instance = *instance;
   init_info.PhysicalDevice = *chosenGPU;
@@ -270,31 +420,99 @@ CommandBuffer Engine::initFrame() {
       device.waitForFences({*frame.renderFence}, true, 10000000000000));
   device.resetFences({*frame.renderFence});
 
-  std::pair<vk::Result, uint32_t> result;
-  try {
-    result = swapchain.swapchain.acquireNextImage(10000000000000,
-                                                  *frame.swapchainSemaphore);
-  } catch (vk::OutOfDateKHRError &exc) {
-    shouldRegenerate = true;
-    frameCounter++;
-    return val::CommandBuffer(*this, vk::CommandBuffer(nullptr));
+  if (initConfig.headless) {
+    imageIndex = frameCounter % swapchain.images.size();
+  } else {
+    std::pair<vk::Result, uint32_t> result;
+    try {
+      result = swapchain.swapchain.acquireNextImage(10000000000000,
+                                                    *frame.swapchainSemaphore);
+    } catch (vk::OutOfDateKHRError &exc) {
+      shouldRegenerate = true;
+      frameCounter++;
+      return val::CommandBuffer(*this, vk::CommandBuffer(nullptr));
+    }
+
+    imageIndex = result.second;
   }
 
-  imageIndex = result.second;
+  for (auto &thread : frame.threads) {
+    thread.pool.reset();
+    thread.used = 0;
+  }
 
   auto cmd = CommandBuffer(*this, *frame.commandBuffer);
   cmd.begin();
+  profiler.beginFrame(cmd.cmd, frameCounter % FRAMES_IN_FLIGHT, frameCounter);
 
   frame.deletionQueue.clear();
   frame.deletionQueue = std::move(deletionQueue);
   return cmd;
 }
 
+CommandBuffer Engine::beginSecondary(uint32_t thread,
+                                     const PassInheritance &pass) {
+  auto &frame = frames[frameCounter % FRAMES_IN_FLIGHT];
+  assert(thread < frame.threads.size());
+  auto &commands = frame.threads[thread];
+
+  if (commands.used == commands.secondaries.size()) {
+    vk::CommandBufferAllocateInfo allocInfo;
+    allocInfo.commandPool = *commands.pool;
+    allocInfo.commandBufferCount = 1;
+    allocInfo.level = vk::CommandBufferLevel::eSecondary;
+    commands.secondaries.push_back(
+        std::move(device.allocateCommandBuffers(allocInfo)[0]));
+  }
+  auto secondary = *commands.secondaries[commands.used++];
+  beginInherited(secondary, pass,
+                 vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+  return CommandBuffer(*this, secondary);
+}
+
+vk::raii::CommandBuffer Engine::allocateReusable() {
+  vk::CommandBufferAllocateInfo allocInfo;
+  allocInfo.commandPool = *reusablePool;
+  allocInfo.commandBufferCount = 1;
+  allocInfo.level = vk::CommandBufferLevel::eSecondary;
+  return std::move(device.allocateCommandBuffers(allocInfo)[0]);
+}
+
+CommandBuffer Engine::beginReusable(vk::CommandBuffer secondary,
+                                    const PassInheritance &pass) {
+  // Begin resets it, the pool allows individual resets
+  beginInherited(secondary, pass, {});
+  return CommandBuffer(*this, secondary);
+}
+
+void Engine::beginInherited(vk::CommandBuffer secondary,
+                            const PassInheritance &pass,
+                            vk::CommandBufferUsageFlags flags) {
+  vk::CommandBufferInheritanceRenderingInfo rendering;
+  rendering.colorAttachmentCount = (uint32_t)pass.colorFormats.size();
+  rendering.pColorAttachmentFormats = pass.colorFormats.data();
+  rendering.depthAttachmentFormat = pass.depthFormat;
+  rendering.rasterizationSamples = pass.samples;
+
+  vk::CommandBufferInheritanceInfo inheritance;
+  inheritance.pNext = &rendering;
+  // Statistics scopes of the primary may enclose the pass
+  inheritance.pipelineStatistics = profiler.getStatisticsFlags();
+
+  vk::CommandBufferBeginInfo beginInfo;
+  beginInfo.flags = flags | vk::CommandBufferUsageFlagBits::eRenderPassContinue;
+  beginInfo.pInheritanceInfo = &inheritance;
+  secondary.begin(beginInfo);
+}
+
 void Engine::submitFrame(Texture *backbuffer) {
   auto &frame = frames[frameCounter % FRAMES_IN_FLIGHT];
 
   auto cmd = CommandBuffer(*this, *frame.commandBuffer);
   auto image = swapchain.images[imageIndex];
+  auto imageLayout = vk::ImageLayout::eUndefined;
+  // The backbuffer is already the swapchain image, there is nothing to copy
+  bool inPlace = backbuffer != nullptr && backbuffer == getSwapchainTarget();
   if (backbuffer != nullptr) {
     if (initConfig.useImGUI) {
       Texture *fb[1] = {backbuffer};
@@ -304,6 +522,9 @@ void Engine::submitFrame(Texture *backbuffer) {
                                       *frame.commandBuffer);
       cmd.endPass();
     }
+    imageLayout = vk::ImageLayout::eColorAttachmentOptimal;
+  }
+  if (backbuffer != nullptr && !inPlace) {
     cmd.transitionImage(backbuffer->image, 0, vk::RemainingMipLevels,
                         vk::ImageLayout::eUndefined,
                         vk::ImageLayout::eTransferSrcOptimal);
@@ -336,17 +557,46 @@ void Engine::submitFrame(Texture *backbuffer) {
     blitInfo.dstImageLayout = vk::ImageLayout::eTransferDstOptimal;
 
     frame.commandBuffer.blitImage2(blitInfo);
+    imageLayout = vk::ImageLayout::eTransferDstOptimal;
   }
 
+  // Headless images are left ready to be copied out
   cmd.transitionImage(swapchain.images[imageIndex], 0, vk::RemainingMipLevels,
-                      vk::ImageLayout::eUndefined,
-                      vk::ImageLayout::ePresentSrcKHR);
+                      imageLayout,
+                      initConfig.headless ? vk::ImageLayout::eTransferSrcOptimal
+                                          : vk::ImageLayout::ePresentSrcKHR);
+
+  if (frameReadback) {
+    vk::BufferImageCopy region;
+    region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = vk::Extent3D{windowSize.w, windowSize.h, 1};
+    cmd.cmd.copyImageToBuffer(swapchain.images[imageIndex],
+                              vk::ImageLayout::eTransferSrcOptimal,
+                              frameReadback->buffer, region);
+    cmd.memoryBarrier(vk::PipelineStageFlagBits2::eTransfer,
+                      vk::AccessFlagBits2::eTransferWrite,
+                      vk::PipelineStageFlagBits2::eHost,
+                      vk::AccessFlagBits2::eHostRead);
+    frameReadback = nullptr;
+  }
 
+  profiler.endFrame(cmd.cmd);
   frame.commandBuffer.end();
 
   vk::CommandBufferSubmitInfo commandBufferSubmitInfo;
   commandBufferSubmitInfo.commandBuffer = *frame.commandBuffer;
 
+  vk::SubmitInfo2 submitInfo;
+  submitInfo.commandBufferInfoCount = 1;
+  submitInfo.pCommandBufferInfos = &commandBufferSubmitInfo;
+
+  if (initConfig.headless) {
+    graphicsQueue.submit2({submitInfo}, *frame.renderFence);
+    frameCounter++;
+    return;
+  }
+
   vk::SemaphoreSubmitInfo waitInfo, signalInfo;
 
   waitInfo.semaphore = *frame.swapchainSemaphore;
@@ -355,13 +605,10 @@ void Engine::submitFrame(Texture *backbuffer) {
   signalInfo.semaphore = *frame.renderSemaphore;
   signalInfo.stageMask = vk::PipelineStageFlagBits2::eAllGraphics;
 
-  vk::SubmitInfo2 submitInfo;
   submitInfo.waitSemaphoreInfoCount = 1;
   submitInfo.pWaitSemaphoreInfos = &waitInfo;
   submitInfo.signalSemaphoreInfoCount = 1;
   submitInfo.pSignalSemaphoreInfos = &signalInfo;
-  submitInfo.commandBufferInfoCount = 1;
-  submitInfo.pCommandBufferInfos = &commandBufferSubmitInfo;
 
   graphicsQueue.submit2({submitInfo}, *frame.renderFence);
 
@@ -396,6 +643,28 @@ CPUBuffer *Engine::createCpuBuffer(size_t size) {
   vmaAllocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
 
   auto buffer = cpuBufferPool.allocate();
+  allocationStats.cpuBuffers++;
+
+  buffer->buffer = raii::Buffer(vma, bufferInfo, vmaAllocInfo);
+  buffer->size = size;
+
+  return buffer;
+}
+
+CPUBuffer *Engine::createReadbackBuffer(size_t size) {
+  VkBufferCreateInfo bufferInfo = {.sType =
+                                       VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+  bufferInfo.pNext = nullptr;
+  bufferInfo.size = size;
+
+  bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+  VmaAllocationCreateInfo vmaAllocInfo = {};
+  vmaAllocInfo.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+  vmaAllocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+  auto buffer = cpuBufferPool.allocate();
+  allocationStats.cpuBuffers++;
 
   buffer->buffer = raii::Buffer(vma, bufferInfo, vmaAllocInfo);
   buffer->size = size;
@@ -418,6 +687,27 @@ StorageBuffer *Engine::createStorageBuffer(uint32_t size,
   vmaallocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
   vmaallocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
   auto buffer = bufferPool.allocate();
+  allocationStats.storageBuffers++;
+  buffer->buffer = raii::Buffer(vma, bufferInfo, vmaallocInfo);
+  buffer->size = size;
+  buffer->bindPoint = bindings.bindStorageBuffer(buffer->buffer);
+
+  return buffer;
+}
+
+StorageBuffer *Engine::createHostStorageBuffer(uint32_t size) {
+  VkBufferCreateInfo bufferInfo = {.sType =
+                                       VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+  bufferInfo.pNext = nullptr;
+  bufferInfo.size = size;
+
+  bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+  VmaAllocationCreateInfo vmaallocInfo = {};
+  vmaallocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+  vmaallocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+  auto buffer = bufferPool.allocate();
+  allocationStats.storageBuffers++;
   buffer->buffer = raii::Buffer(vma, bufferInfo, vmaallocInfo);
   buffer->size = size;
   buffer->bindPoint = bindings.bindStorageBuffer(buffer->buffer);
@@ -427,6 +717,7 @@ StorageBuffer *Engine::createStorageBuffer(uint32_t size,
 
 Mesh *Engine::createMesh(size_t verticesSize, uint32_t indicesCount) {
   auto mesh = meshPool.allocate();
+  allocationStats.meshes++;
   mesh->indicesCount = indicesCount;
   mesh->verticesSize = verticesSize;
 
@@ -8,11 +8,15 @@
 #include "binding.hpp"
 #include "commands.hpp"
 #include "gpu_resources.hpp"
+#include "profiler.hpp"
 #include "raii.hpp"
 #include "types.hpp"
 
 namespace val {
 
+class GraphicsPipeline;
+class ComputePipeline;
+
 class PresentationProvider {
 public:
   virtual VkSurfaceKHR getSurface(VkInstance ins) = 0;
@@ -20,6 +24,18 @@ public:
   virtual void initImgui() {}
 };
 
+// Number of GPU resources created since the engine started
+struct AllocationStats {
+  uint64_t textures{};
+  uint64_t storageBuffers{};
+  uint64_t cpuBuffers{};
+  uint64_t meshes{};
+
+  uint64_t total() const {
+    return textures + storageBuffers + cpuBuffers + meshes;
+  }
+};
+
 class Engine {
   friend class PipelineBuilder;
   friend class CommandBuffer;
@@ -33,12 +49,16 @@ private:
     std::vector<StorageBuffer> buffers;
     std::vector<Mesh> meshes;
     std::vector<raii::Buffer> rawBuffers;
+    std::vector<vk::raii::Pipeline> pipelines;
+    std::vector<vk::raii::PipelineLayout> pipelineLayouts;
 
     void clear() {
       textures.clear();
       buffers.clear();
       meshes.clear();
       rawBuffers.clear();
+      pipelines.clear();
+      pipelineLayouts.clear();
     }
   };
 
@@ -47,11 +67,28 @@ private:
     std::vector<vk::raii::ImageView> imageViews;
 
     vk::raii::SwapchainKHR swapchain{nullptr};
+
+    // Backing storage for images when running headless
+    std::vector<raii::Image> headlessImages;
+
+    // Non owning textures over images, only with renderToSwapchain
+    std::vector<Texture> targets;
+    // Format the surface gave the images, requested again on recreation
+    TextureFormat format = TextureFormat::BGRA8;
+  };
+
+  // Secondary command buffers of one recording thread, reused every time
+  // the frame comes around
+  struct ThreadCommands {
+    vk::raii::CommandPool pool{nullptr};
+    std::vector<vk::raii::CommandBuffer> secondaries;
+    uint32_t used{};
   };
 
   struct FrameData {
     vk::raii::CommandPool pool{nullptr};
     vk::raii::CommandBuffer commandBuffer{nullptr};
+    std::vector<ThreadCommands> threads;
 
     vk::raii::Semaphore swapchainSemaphore{nullptr}, renderSemaphore{nullptr};
     vk::raii::Fence renderFence{nullptr};
@@ -93,8 +130,11 @@ private:
 
   Swapchain swapchain;
   FrameData frames[FRAMES_IN_FLIGHT];
+  // Secondaries that outlive the frame, see allocateReusable
+  vk::raii::CommandPool reusablePool{nullptr};
 
   GlobalBinding bindings;
+  GpuProfiler profiler;
 
   Pool<StorageBuffer, 4096> bufferPool;
   Pool<Texture, 4096> texturePool;
@@ -103,18 +143,29 @@ private:
 
   DeletionQueue deletionQueue;
 
+  // Filled by the next submitFrame, see readbackFrame
+  CPUBuffer *frameReadback{};
+
+  AllocationStats allocationStats;
+
   void initVulkan();
   void reloadSwapchain();
+  void initHeadlessImages();
+  void initSwapchainTargets();
   void initFrameData();
 
   void initImgui();
 
+  void beginInherited(vk::CommandBuffer secondary, const PassInheritance &pass,
+                      vk::CommandBufferUsageFlags flags);
+
   void regenerate();
 
   Texture *createTextureBase(Size size, uint32_t levels, TextureFormat format,
                              TextureSampler sampling = TextureSampler::NEAREST,
                              uint32_t mipLevels = 1,
-                             VkImageUsageFlags usage = 0, bool cubemap = false);
+                             VkImageUsageFlags usage = 0, bool cubemap = false,
+                             uint32_t samples = 1);
 
 public:
   Engine() = default;
@@ -129,10 +180,74 @@ public:
 
   void update();
 
+  bool isHeadless() const { return initConfig.headless; }
+  // False when renderToSwapchain was requested but the surface format cannot
+  // be rendered to, submitFrame then expects an image to blit
+  bool rendersToSwapchain() const { return initConfig.renderToSwapchain; }
+  TextureFormat getSwapchainFormat() const { return swapchain.format; }
+
+  // Image acquired for the current frame, only valid between initFrame and
+  // submitFrame. Null unless renderToSwapchain is set.
+  Texture *getSwapchainTarget() {
+    if (swapchain.targets.empty()) {
+      return nullptr;
+    }
+    return &swapchain.targets[imageIndex];
+  }
+
+  const char *getDeviceName() const {
+    return physicalDeviceProperties.deviceName.data();
+  }
+
+  const AllocationStats &getAllocationStats() const { return allocationStats; }
+
+  // Counter of the frame being recorded, matches FrameProfile::frame
+  uint32_t getFrameNumber() const { return frameCounter; }
+  // Frame in flight being recorded, resources replicated per frame in
+  // flight are indexed with it
+  uint32_t getFrameSlot() const { return frameCounter % FRAMES_IN_FLIGHT; }
+
+  // Latest GPU timings and pipeline statistics that finished executing
+  const FrameProfile &getGpuProfile() const {
+    return profiler.getLastFrame();
+  }
+  // Results of the last frames in flight, which getGpuProfile only returns
+  // once later frames start. Call after waitFinishAllCommands
+  std::vector<FrameProfile> collectGpuProfiles() {
+    return profiler.readPending();
+  }
+
   CommandBuffer initFrame();
 
   void submitFrame(Texture *backbuffer);
 
+  // Bytes readbackFrame copies, the frame's pixels row by row in the
+  // swapchain format
+  size_t getFrameReadbackSize() const {
+    return size_t(windowSize.w) * windowSize.h * 4;
+  }
+  // Headless only, the next submitFrame copies the finished image into a
+  // readback buffer of getFrameReadbackSize bytes. Read it with
+  // readCPUBuffer once that frame has finished
+  void readbackFrame(CPUBuffer *buffer) {
+    assert(initConfig.headless);
+    frameReadback = buffer;
+  }
+
+  // Begins a secondary command buffer for the contents of a pass begun with
+  // CommandBuffer::beginSecondaryPass, end it with CommandBuffer::end. Each
+  // thread recording at the same time passes its own index below
+  // EngineInitConfig::recordingThreads. Only valid until submitFrame
+  CommandBuffer beginSecondary(uint32_t thread, const PassInheritance &pass);
+
+  // Secondary command buffer that is executed again every time its frame
+  // slot comes around. Allocate and record it on the thread recording the
+  // frame, and record it again only while the frames that executed it are
+  // done, see val::ReusablePass
+  vk::raii::CommandBuffer allocateReusable();
+  CommandBuffer beginReusable(vk::CommandBuffer secondary,
+                              const PassInheritance &pass);
+
   Texture *createTexture(Size size, TextureFormat format,
                          TextureSampler sampling = TextureSampler::NEAREST,
                          uint32_t mipLevels = 1, VkImageUsageFlags usage = 0) {
@@ -145,14 +260,29 @@ public:
   }
   Texture *createCubemap(Size size, TextureFormat format,
                          TextureSampler sampling = TextureSampler::LINEAR,
-                         VkImageUsageFlags flags = 0) {
-    return createTextureBase(size, 6, format, sampling, 1, flags, true);
+                         uint32_t mipLevels = 1, VkImageUsageFlags flags = 0) {
+    return createTextureBase(size, 6, format, sampling, mipLevels, flags, true);
+  }
+
+  // Render target that can be read per sample with texelFetch on a
+  // sampler2DMS
+  Texture *createMultisampledTexture(Size size, TextureFormat format,
+                                     uint32_t samples) {
+    return createTextureBase(size, 1, format, TextureSampler::NEAREST, 1, 0,
+                             false, samples);
   }
 
   CPUBuffer *createCpuBuffer(size_t size);
+  // Host visible buffer the GPU copies into, read it with readCPUBuffer once
+  // the frame that filled it has finished
+  CPUBuffer *createReadbackBuffer(size_t size);
   StorageBuffer *createStorageBuffer(
       uint32_t size,
       vk::BufferUsageFlagBits usage = vk::BufferUsageFlagBits(0));
+  // Storage buffer in host visible memory that stays mapped, for data the
+  // CPU rewrites every frame. Write it with writeStorageBuffer while no
+  // frame in flight reads it
+  StorageBuffer *createHostStorageBuffer(uint32_t size);
 
   Mesh *createMesh(size_t verticesSize, uint32_t indicesCount);
 
@@ -161,6 +291,20 @@ public:
     memcpy(buffer->buffer.allocInfo.pMappedData, data, size);
   }
 
+  void writeStorageBuffer(StorageBuffer *buffer, const void *data,
+                          size_t start, size_t size) {
+    assert(buffer->buffer.allocInfo.pMappedData);
+    assert(start + size <= buffer->size);
+    memcpy((uint8_t *)buffer->buffer.allocInfo.pMappedData + start, data, size);
+    vmaFlushAllocation(vma, buffer->buffer.alloc, start, size);
+  }
+
+  void readCPUBuffer(CPUBuffer *buffer, void *data, size_t size) {
+    assert(buffer->size == size);
+    vmaInvalidateAllocation(vma, buffer->buffer.alloc, 0, size);
+    memcpy(data, buffer->buffer.allocInfo.pMappedData, size);
+  }
+
   void freeTexture(Texture *t) {
     deletionQueue.textures.push_back(std::move(*t));
     texturePool.destroy(t);
@@ -181,6 +325,11 @@ public:
     meshPool.destroy(mesh);
   }
 
+  // Keeps the pipeline alive until the frames recorded with it are done, so
+  // it can be replaced in the middle of a frame
+  void destroyPipeline(GraphicsPipeline &pipeline);
+  void destroyPipeline(ComputePipeline &pipeline);
+
   vk::DescriptorSetLayout getDescriptorSetLayout() {
     return bindings.getLayout();
   }
@@ -22,6 +22,11 @@ namespace val
   {
     RGBA8 = VK_FORMAT_R8G8B8A8_SRGB,
     RGBA16 = VK_FORMAT_R16G16B16A16_SFLOAT,
+    R32 = VK_FORMAT_R32_SFLOAT,
+    // Packed HDR colour without alpha or negative values, half the size of
+    // RGBA16
+    B10G11R11 = VK_FORMAT_B10G11R11_UFLOAT_PACK32,
+    BGRA8 = VK_FORMAT_B8G8R8A8_SRGB,
     DEPTH32 = VK_FORMAT_D32_SFLOAT
   };
 
@@ -58,6 +63,17 @@ namespace val
   {
     PresentationFormat presentation;
     bool useImGUI{};
+    // Render into an engine-owned image ring instead of a swapchain, no
+    // surface or PresentationProvider is needed
+    bool headless{};
+    Size headlessSize{};
+    // Expose the acquired swapchain image as a render target through
+    // getSwapchainTarget, submitting it skips the blit. Turned off when the
+    // surface has no sRGB format, see Engine::rendersToSwapchain
+    bool renderToSwapchain{};
+    // Threads that record secondary command buffers at the same time, each
+    // gets its own command pool per frame in flight
+    uint32_t recordingThreads = 1;
     vk::PhysicalDeviceVulkan13Features features;
     vk::PhysicalDeviceVulkan12Features features12;
     vk::PhysicalDeviceFeatures features10;
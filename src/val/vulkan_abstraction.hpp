@@ -2,5 +2,9 @@
 // This class is more like a wrapper, it is intended to reduce boilerplate by
 // wrapping vulkan code into more usable functions and types
 
+#include "param_block.hpp"
+#include "pass_recorder.hpp"
+#include "per_frame.hpp"
 #include "pipelines.hpp"
+#include "scheduler.hpp"
 #include "system.hpp"
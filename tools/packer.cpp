@@ -0,0 +1,149 @@
+// Builds res/assets.pack, see src/foundation/pack.hpp for the layout.
+// Usage: AssetPacker <res dir> <output> <directory relative to res>...
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "foundation/hash.hpp"
+#include "foundation/pack.hpp"
+
+namespace fs = std::filesystem;
+
+struct Asset {
+  std::string name;
+  pack::EntryType type;
+  uint32_t width{}, height{};
+  uint64_t hash;
+  std::vector<uint8_t> payload;
+};
+
+static bool isImage(const fs::path &path) {
+  auto extension = path.extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return extension == ".bmp" || extension == ".png" || extension == ".jpg" ||
+         extension == ".jpeg" || extension == ".tga";
+}
+
+static std::vector<uint8_t> readFile(const fs::path &path) {
+  std::ifstream file(path, std::ios::ate | std::ios::binary);
+  std::vector<uint8_t> data((size_t)file.tellg());
+  file.seekg(0);
+  file.read((char *)data.data(), data.size());
+  return data;
+}
+
+static bool loadAsset(const fs::path &resDir, const fs::path &path,
+                      Asset &asset) {
+  asset.name = fs::relative(path, resDir).generic_string();
+  if (asset.name.size() >= pack::NAME_SIZE) {
+    printf("Name too long for the pack: %s\n", asset.name.c_str());
+    return false;
+  }
+
+  auto data = readFile(path);
+  asset.hash = hash::fnv1a(data.data(), data.size());
+
+  if (!isImage(path)) {
+    asset.type = pack::EntryType::RAW;
+    asset.payload = std::move(data);
+    return true;
+  }
+
+  // Decoded here so startup only copies the pixels
+  int w, h, channels;
+  uint8_t *pixels =
+      stbi_load_from_memory(data.data(), (int)data.size(), &w, &h, &channels, 4);
+  if (!pixels) {
+    printf("Cannot decode %s\n", asset.name.c_str());
+    return false;
+  }
+  asset.type = pack::EntryType::IMAGE_RGBA8;
+  asset.width = w;
+  asset.height = h;
+  asset.payload.assign(pixels, pixels + size_t(w) * h * 4);
+  stbi_image_free(pixels);
+  return true;
+}
+
+static size_t align(size_t offset) {
+  return (offset + pack::ALIGNMENT - 1) / pack::ALIGNMENT * pack::ALIGNMENT;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 4) {
+    printf("Usage: %s <res dir> <output> <directory>...\n", argv[0]);
+    return 1;
+  }
+  fs::path resDir = argv[1];
+  fs::path output = argv[2];
+
+  std::vector<Asset> assets;
+  for (int i = 3; i < argc; i++) {
+    for (auto &entry : fs::recursive_directory_iterator(resDir / argv[i])) {
+      if (!entry.is_regular_file()) {
+        continue;
+      }
+      Asset asset;
+      if (!loadAsset(resDir, entry.path(), asset)) {
+        return 1;
+      }
+      assets.push_back(std::move(asset));
+    }
+  }
+  // The engine binary searches the index
+  std::sort(assets.begin(), assets.end(),
+            [](const Asset &a, const Asset &b) { return a.name < b.name; });
+
+  pack::Header header{.magic = pack::MAGIC,
+                      .version = pack::VERSION,
+                      .entryCount = (uint32_t)assets.size()};
+  std::vector<pack::Entry> index(assets.size());
+  size_t offset =
+      align(sizeof(pack::Header) + assets.size() * sizeof(pack::Entry));
+  for (size_t i = 0; i < assets.size(); i++) {
+    auto &entry = index[i];
+    memset(&entry, 0, sizeof(entry));
+    memcpy(entry.name, assets[i].name.c_str(), assets[i].name.size());
+    entry.offset = offset;
+    entry.size = assets[i].payload.size();
+    entry.hash = assets[i].hash;
+    entry.type = assets[i].type;
+    entry.width = assets[i].width;
+    entry.height = assets[i].height;
+    offset = align(offset + entry.size);
+  }
+
+  // Renamed over the old pack once complete, a running engine keeps its
+  // mapping of the old file
+  auto temporary = output;
+  temporary += ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write((const char *)&header, sizeof(header));
+    file.write((const char *)index.data(), index.size() * sizeof(pack::Entry));
+    for (size_t i = 0; i < assets.size(); i++) {
+      // Padding up to the aligned offset
+      while ((size_t)file.tellp() < index[i].offset) {
+        file.put(0);
+      }
+      file.write((const char *)assets[i].payload.data(),
+                 assets[i].payload.size());
+    }
+    if (!file.good()) {
+      printf("Cannot write %s\n", temporary.string().c_str());
+      return 1;
+    }
+  }
+  fs::rename(temporary, output);
+
+  printf("Packed %zu assets into %s\n", assets.size(),
+         output.string().c_str());
+  return 0;
+}